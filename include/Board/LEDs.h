@@ -0,0 +1,37 @@
+/*  LUFA board LED driver (BOARD_USER), for the status LED of the board
+    selected in board.hpp.
+
+    Boards have at most one usable LED. It is lit while LEDS_LED4 is set,
+    which is while the USB interface is ready (LEDMASK_USB_READY in
+    mouse.h).
+*/
+
+#ifndef __LEDS_USER_H__
+#define __LEDS_USER_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+#define LEDS_LED1        (1 << 0)
+#define LEDS_LED2        (1 << 1)
+#define LEDS_LED3        (1 << 2)
+#define LEDS_LED4        (1 << 3)
+#define LEDS_ALL_LEDS    (LEDS_LED1 | LEDS_LED2 | LEDS_LED3 | LEDS_LED4)
+#define LEDS_NO_LEDS     0
+
+void LEDs_Init(void);
+void LEDs_Disable(void);
+void LEDs_SetAllLEDs(const uint8_t LEDMask);
+uint8_t LEDs_GetLEDs(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,100 @@
+/*  Pointer acceleration.
+
+    The gain applied to each C1351 sample depends on the sample's speed
+    (the larger of its X and Y movement). Gains come from lookup tables in
+    flash, one per ACCEL_PROFILE_*, which are computed at compile time from
+    the curve parameters below. Applying the acceleration costs one table
+    lookup and one multiply per axis, with no floating point.
+*/
+
+#pragma once
+#ifndef ACCELERATION_HPP
+#define ACCELERATION_HPP
+
+#include <avr/pgmspace.h>
+#include <stdint.h>
+
+#include "settings.h"
+
+
+namespace c1351_mouse {
+
+/* Gains are fixed point, with ACCEL_GAIN_SHIFT fractional bits */
+const uint8_t ACCEL_GAIN_SHIFT = 4;
+const uint8_t ACCEL_GAIN_ONE = 1 << ACCEL_GAIN_SHIFT;
+
+/* The table is indexed by speed in C1351 steps (2 uS) per sample. One step
+ * is 2 << log2(F_CPU / 1 MHz) capture timer ticks.
+ */
+const uint8_t ACCEL_TABLE_SIZE = 32;
+constexpr uint8_t constLog2(uint32_t n)
+{
+    return n > 1 ? 1 + constLog2(n / 2) : 0;
+}
+const uint8_t ACCEL_SPEED_SHIFT = constLog2(F_CPU / 1000000) + 1;
+
+/* Curve parameters. Speeds are in steps per sample. */
+const uint8_t ACCEL_MAX_GAIN = 4 * ACCEL_GAIN_ONE;
+// Linear: unity gain up to the threshold speed, then rising by
+// ACCEL_LINEAR_SLOPE per step, up to ACCEL_MAX_GAIN
+const uint8_t ACCEL_LINEAR_THRESHOLD = 2;
+const uint8_t ACCEL_LINEAR_SLOPE = ACCEL_GAIN_ONE / 4;
+// Sigmoid: smooth S-curve from unity gain to ACCEL_MAX_GAIN, centered at
+// ACCEL_SIGMOID_CENTER and ACCEL_SIGMOID_WIDTH steps wide
+const uint8_t ACCEL_SIGMOID_CENTER = 8;
+const uint8_t ACCEL_SIGMOID_WIDTH = 12;
+
+
+struct AccelTable {
+    uint8_t gain[ACCEL_TABLE_SIZE];
+};
+
+
+constexpr uint8_t linearGain(uint8_t speed)
+{
+    if (speed <= ACCEL_LINEAR_THRESHOLD) {
+        return ACCEL_GAIN_ONE;
+    }
+    uint16_t gain = ACCEL_GAIN_ONE + (speed - ACCEL_LINEAR_THRESHOLD) * ACCEL_LINEAR_SLOPE;
+    return gain < ACCEL_MAX_GAIN ? gain : ACCEL_MAX_GAIN;
+}
+
+
+constexpr uint8_t sigmoidGain(uint8_t speed)
+{
+    // smoothstep 3t^2 - 2t^3, with t in 1/256 units
+    int32_t t = ((int32_t)speed - (ACCEL_SIGMOID_CENTER - ACCEL_SIGMOID_WIDTH / 2)) * 256 /
+                ACCEL_SIGMOID_WIDTH;
+    t = t < 0 ? 0 : (t > 256 ? 256 : t);
+    int32_t s = t * t * (3 * 256 - 2 * t) / (256 * 256);
+    return ACCEL_GAIN_ONE + (ACCEL_MAX_GAIN - ACCEL_GAIN_ONE) * s / 256;
+}
+
+
+constexpr AccelTable makeAccelTable(uint8_t profile)
+{
+    AccelTable table {};
+    for (uint8_t speed = 0; speed < ACCEL_TABLE_SIZE; speed++) {
+        table.gain[speed] = profile == ACCEL_PROFILE_LINEAR ? linearGain(speed) :
+                            profile == ACCEL_PROFILE_SIGMOID ? sigmoidGain(speed) :
+                            ACCEL_GAIN_ONE;
+    }
+    return table;
+}
+
+
+extern const AccelTable accel_tables[ACCEL_PROFILE_COUNT] PROGMEM;
+
+
+/* Returns the gain for a sample with the given speed in capture timer ticks */
+inline uint8_t getAccelGain(uint8_t profile, uint16_t speed)
+{
+    uint16_t index = speed >> ACCEL_SPEED_SHIFT;
+    if (index >= ACCEL_TABLE_SIZE) {
+        index = ACCEL_TABLE_SIZE - 1;
+    }
+    return pgm_read_byte(&accel_tables[profile].gain[index]);
+}
+
+}
+#endif
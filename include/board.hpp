@@ -0,0 +1,158 @@
+/*  Board pin maps.
+
+    The DB9 lines need particular ATmega32u4 functions: POTX and POTY the
+    input capture pins ICP1 and ICP3 (or ADC pins, depending on the capture
+    backend, see capture_timer.hpp), DB9 pin 1 the INT1 interrupt, and DB9
+    pins 2 and 3 pin change interrupts (see quadrature.hpp). Most 32u4
+    boards therefore wire the DB9 port to the same MCU pins. Boards differ
+    in the labels of those pins and in their status LED.
+
+    The board is chosen at compile time with one of the ADAPTER_BOARD_*
+    macros (see platformio.ini), and defaults to the ItsyBitsy 32u4. Traits
+    only contain types and constants, so pin accesses compile to the same
+    instructions as hard-coded Pin<> types. To support another board, add a
+    traits struct here and an environment in platformio.ini.
+
+  DB9   MCU   ItsyBitsy 32u4,     Teensy 2.0   Function
+              Leonardo, Yun
+ ----- ----- ------------------- ------------ ------------
+    1   PD1   2 (SDA)             D1           INT1
+    2   PB1   SCK                 B1           PCINT1
+    3   PB4   8                   B4           PCINT4
+    4   PD7   6                   D7           GPIO
+    5   PC7   13                  C7           ICP3 (POTY)
+    6   PD0   3 (SCL)             D0           GPIO
+    7   Vcc   5V                  VCC
+    8   GND   GND                 GND
+    9   PD4   4                   D4           ICP1 (POTX)
+        PB6   10                  B6           debug output
+
+    The Sparkfun Pro Micro uses the same pins and labels as the ItsyBitsy,
+    except for DB9 pin 5 (POTY), which is on A0 (PF7). With the pin change
+    capture backend, DB9 pin 5 is on TX (PD3) and DB9 pin 9 on RX (PD2).
+*/
+
+#pragma once
+#ifndef BOARD_HPP
+#define BOARD_HPP
+
+#include <stdint.h>
+
+#include "capture_timer.hpp"
+#include "iopin.hpp"
+
+
+namespace c1351_mouse {
+
+/* Status LED on a pin, lit when the pin is high if ActiveHigh */
+template<typename LedPin, bool ActiveHigh>
+struct PinLed {
+    static const bool PRESENT = true;
+
+    static inline void init()
+    {
+        LedPin::setDirectionOut();
+        set(false);
+    }
+    static inline void set(bool on)
+    {
+        if (on == ActiveHigh) {
+            LedPin::high();
+        }
+        else {
+            LedPin::low();
+        }
+    }
+};
+
+
+/* No usable status LED */
+struct NoLed {
+    static const bool PRESENT = false;
+
+    static inline void init() {}
+    static inline void set(bool) {}
+};
+
+
+/* DB9 pins and capture timers of all ATmega32u4 boards */
+struct Atmega32u4Pins {
+    typedef Pin<PortD, 1> UpBtn2;    // DB9 pin 1, INT1
+    typedef Pin<PortB, 1> Down;      // DB9 pin 2, PCINT1
+    typedef Pin<PortB, 4> Left;      // DB9 pin 3, PCINT4
+    typedef Pin<PortD, 7> Right;     // DB9 pin 4
+    typedef Pin<PortC, 7> PotY;      // DB9 pin 5, ICP3
+    typedef Pin<PortD, 0> Btn1;      // DB9 pin 6
+    typedef Pin<PortD, 4> Btn2PotX;  // DB9 pin 9, ICP1
+    typedef Pin<PortB, 6> Debug;
+
+    static const TimerNumber POTX_TIMER = TIMER_1;
+    static const TimerNumber POTY_TIMER = TIMER_3;
+};
+
+
+/* The LED on pin 13 is on ICP3 and must be removed */
+struct ItsyBitsy32u4Board : Atmega32u4Pins {
+    typedef NoLed StatusLed;
+};
+
+
+/* The L LED on pin 13 is on ICP3 and must be removed. The TX LED is used
+ * instead.
+ */
+struct LeonardoBoard : Atmega32u4Pins {
+    typedef PinLed<Pin<PortD, 5>, false> StatusLed;
+};
+
+
+/* Same pinout as the Leonardo */
+struct YunBoard : LeonardoBoard {
+};
+
+
+struct Teensy2Board : Atmega32u4Pins {
+    typedef PinLed<Pin<PortD, 6>, true> StatusLed;
+};
+
+
+/* No ICP3 pin, POTY is on A0 and read through the analog comparator, see
+ * CAPTURE_BACKEND_COMPARATOR. With CAPTURE_BACKEND_PIN_CHANGE, POTX and
+ * POTY are on the RX and TX pins instead. The TX LED is the status LED.
+ */
+struct ProMicroBoard : Atmega32u4Pins {
+#ifdef CAPTURE_BACKEND_PIN_CHANGE
+    typedef Pin<PortD, 3> PotY;      // DB9 pin 5, TX (INT3)
+    typedef Pin<PortD, 2> Btn2PotX;  // DB9 pin 9, RX (INT2)
+#else
+    typedef Pin<PortF, 7> PotY;  // DB9 pin 5, A0 (ADC7)
+#endif
+
+    typedef PinLed<Pin<PortD, 5>, false> StatusLed;
+};
+
+
+template<typename P, typename Port, uint8_t Bit>
+constexpr bool isPin()
+{
+    return IsSameType<typename P::Port, Port>::value && P::BIT == Bit;
+}
+
+
+#if defined(ADAPTER_BOARD_LEONARDO)
+typedef LeonardoBoard Board;
+#elif defined(ADAPTER_BOARD_YUN)
+typedef YunBoard Board;
+#elif defined(ADAPTER_BOARD_TEENSY2)
+typedef Teensy2Board Board;
+#elif defined(ADAPTER_BOARD_PRO_MICRO)
+typedef ProMicroBoard Board;
+#else
+typedef ItsyBitsy32u4Board Board;
+#endif
+
+
+static_assert(Board::POTX_TIMER != Board::POTY_TIMER,
+              "POTX and POTY need separate capture channels");
+
+}
+#endif
@@ -0,0 +1,31 @@
+/*  Reports of interrupts that can delay software input capture.
+
+    The pin change capture backend (capture_pin_change.cpp) timestamps
+    edges in an interrupt, which waits while another interrupt runs. Long
+    interrupts call captureBlockerEnd() as their last statement. An edge
+    interrupt that is still pending then arrived while the interrupt ran,
+    from its entry on, and its sample is flagged. With the hardware capture
+    backends this does nothing.
+*/
+
+#pragma once
+#ifndef CAPTURE_BLOCKER_H
+#define CAPTURE_BLOCKER_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+#ifdef CAPTURE_BACKEND_PIN_CHANGE
+void captureBlockerEnd(void);
+#else
+static inline void captureBlockerEnd(void) {}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -5,6 +5,31 @@
 #include <stdint.h>
 
 
+/*  Capture backend, chosen at compile time:
+
+    CAPTURE_BACKEND_ICP (default)
+        Hardware input capture on ICP1 and ICP3, both axes every read cycle
+        (capture_timer.cpp). With CAPTURE_POLLED, the capture registers are
+        read at the end of each read cycle instead of in interrupts.
+
+    CAPTURE_BACKEND_COMPARATOR
+        Hardware input capture of the analog comparator output with timer 1,
+        for boards without ICP3. POTX and POTY are on ADC pins and measured
+        on alternate read cycles (capture_comparator.cpp).
+
+    CAPTURE_BACKEND_PIN_CHANGE
+        Timestamps taken in external interrupts on rising edges, with the
+        interrupt entry latency subtracted, for boards without usable
+        capture pins. Both axes every read cycle (capture_pin_change.cpp).
+
+    All backends have the same interface. TimerNumber names a capture
+    channel, which is the timer with the ICP backend.
+*/
+#if !defined(CAPTURE_BACKEND_COMPARATOR) && !defined(CAPTURE_BACKEND_PIN_CHANGE)
+#define CAPTURE_BACKEND_ICP
+#endif
+
+
 namespace c1351_mouse {
 
 enum TimerNumber {
@@ -19,8 +44,15 @@ uint16_t getInputCaptureTimestamp(TimerNumber);
 void initInputCapture();
 void armInputCapture();
 void disarmInputCapture(TimerNumber);
-/* Returns true if timer is currently running, false otherwise */
+/* Returns true if timer is currently running, false otherwise. With the
+ * comparator backend, a channel not measured in the current cycle reports
+ * whether its last measurement missed the edge.
+ */
 bool timerRunning(TimerNumber);
+/* Returns true if the last timestamp may be late because the edge waited
+ * for another interrupt. Only the pin change backend can be late.
+ */
+bool captureDelayed(TimerNumber);
 
 }
 #endif
@@ -0,0 +1,83 @@
+/*  C1351 capture traces
+
+    A trace records the raw captures of a C1351 read cycle after read cycle,
+    so that real mice can be replayed through the processing code on the
+    host (see tools/c1351replay.cpp). The trace build of the firmware
+    (ENABLE_CAPTURE_TRACE) sends one over the virtual serial port while the
+    host has it open, and tools/c1351record saves it to a file. Traces are
+    little-endian:
+
+    Header, CAPTURE_TRACE_HEADER_SIZE bytes:
+        char     Magic[4]      CAPTURE_TRACE_MAGIC
+        uint8_t  Version       CAPTURE_TRACE_VERSION
+        uint8_t  TicksPerUs    capture timer ticks per microsecond
+        uint16_t CycleUs       read cycle length in microseconds
+        uint8_t  Settings[]    AdapterSettings in effect when recorded,
+                               SETTINGS_REPORT_SIZE bytes (see settings.h)
+
+    Then one record per read cycle, CAPTURE_TRACE_RECORD_SIZE bytes:
+        uint16_t PotX          capture timer ticks from the sync to the
+        uint16_t PotY          POTX and POTY edges (getInputCaptureTimestamp())
+        uint8_t  Flags         TRACE_FLAG_*
+        uint8_t  Skipped       read cycles lost before this one, 0 normally
+
+    CycleUs is the read cycle length when the trace started. Records carry
+    no time, since ReadPhaseMargin can shorten later read cycles (see
+    read_phase.hpp). A timestamp is only meaningful if its
+    TRACE_FLAG_*_CAPTURED flag is set.
+*/
+
+#pragma once
+#ifndef CAPTURE_TRACE_H
+#define CAPTURE_TRACE_H
+
+#include <stdint.h>
+
+#include "settings.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+#define CAPTURE_TRACE_MAGIC "C1TR"
+#define CAPTURE_TRACE_VERSION 1
+#define CAPTURE_TRACE_HEADER_SIZE (8 + SETTINGS_REPORT_SIZE)
+#define CAPTURE_TRACE_RECORD_SIZE 6
+
+enum {
+    TRACE_FLAG_X_CAPTURED = 1 << 0,
+    TRACE_FLAG_Y_CAPTURED = 1 << 1,
+    TRACE_FLAG_LEFT = 1 << 2,
+    TRACE_FLAG_RIGHT = 1 << 3,
+};
+
+
+#ifdef ENABLE_CAPTURE_TRACE
+#ifndef ENABLE_VIRTUAL_SERIAL
+#error "ENABLE_CAPTURE_TRACE needs ENABLE_VIRTUAL_SERIAL"
+#endif
+
+/* Queue the record of a C1351 read cycle. Records are only taken while the
+ * host has the serial port open, and counted as skipped if the queue is
+ * full.
+ */
+void queueTraceRecord(uint16_t pot_x, uint16_t pot_y, uint8_t flags);
+/* Call from the main loop. Starts the trace when the host opens the serial
+ * port, and writes queued records to the port as far as it takes them
+ * without waiting.
+ */
+void sendTrace(void);
+/* Length of the current read cycle in microseconds, for the header.
+ * Implemented in main.cpp.
+ */
+uint16_t getTraceCycleUs(void);
+#endif
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -3,13 +3,15 @@
 
 #include <stdint.h>
 
+#include "board.hpp"
+#include "capture_timer.hpp"
 #include "iopin.hpp"
 
 
 namespace c1351_mouse {
 
 typedef uint16_t PotValue;
-typedef int8_t MouseVelocity;
+typedef int16_t MouseVelocity;
 
 
 /*
@@ -17,38 +19,56 @@ typedef int8_t MouseVelocity;
  *
  *   ICP1 and ICP3 are "input capture" pins, and are required for proportional
  *   mode. The ATMega32u4 has these pins, but not all 32u4-based development
- *   boards expose these pins. As of this writing, the Adafruit ItsyBitsy32u4
- *   is the only small form-factor board that exposes both pins.
+ *   boards expose these pins. See board.hpp for the pins of each supported
+ *   board.
  *
- *   NOTE: the ItsyBitsy pin 13 is tied to the on-board LED, which needs to be
- *   physically removed for the circuit to work properly.
+ *   NOTE: on the ItsyBitsy and the Leonardo, pin 13 is tied to the on-board
+ *   LED, which needs to be physically removed for the circuit to work
+ *   properly.
  *
- *  DB9 (C1351)   ItsyBitsy pin   Function     Prop. mode    Joy. mode
- * ------------- --------------- ----------- -------------- -----------
- *            1   2 (SDA)         GPIO        Rt btn         Up
- *            2   SCK             GPIO        -              Down
- *            3   8               GPIO        -              Left
- *            4   6               GPIO        -              Right
- *            5   13              ICP3        Y pos (POTY)   -
- *            6   3 (SCL)         GPIO        Left btn       Left btn
- *            7   Vcc                         5V             5V
- *            8   GND                         GND            GND
- *            9   4               ICP1/GPIO   X pos (POTX)   Right btn
+ *  DB9 (C1351)   Function     Prop. mode    Joy. mode
+ * ------------- ----------- -------------- -----------
+ *            1   GPIO        Rt btn         Up
+ *            2   GPIO        -              Down
+ *            3   GPIO        -              Left
+ *            4   GPIO        -              Right
+ *            5   ICP3        Y pos (POTY)   -
+ *            6   GPIO        Left btn       Left btn
+ *            7               5V             5V
+ *            8               GND            GND
+ *            9   ICP1/GPIO   X pos (POTX)   Right btn
  */
 struct C1351_IO {
-    Pin<PortB, 1> down;      // ItsyBitsy pin SCK
-    Pin<PortB, 4> left;      // ItsyBitsy pin 8
-    Pin<PortB, 6> debug;     // ItsyBitsy pin 10
+    Board::Down down;          // DB9 pin 2
+    Board::Left left;          // DB9 pin 3
+    Board::Debug debug;
 
-    Pin<PortC, 7> poty;      // ItsyBitsy pin 13, ICP3
+    Board::PotY poty;          // DB9 pin 5
 
-    Pin<PortD, 0> btn1;      // ItsyBitsy pin 3 (SCL)
-    Pin<PortD, 1> up_btn2;   // ItsyBitsy pin 2 (SDA)
-    Pin<PortD, 4> btn2_potx; // ItsyBitsy pin 4, ICP1
-    Pin<PortD, 7> right;     // ItsyBitsy pin 6
+    Board::Btn1 btn1;          // DB9 pin 6
+    Board::UpBtn2 up_btn2;     // DB9 pin 1
+    Board::Btn2PotX btn2_potx; // DB9 pin 9
+    Board::Right right;        // DB9 pin 4
+
+    // POTX and POTY, released together at the start of a read
+    PinGroup<Board::Btn2PotX, Board::PotY> pots;
 };
 
 
+/* Levels of the direction lines, bit n - 1 for DB9 pin n (1-4) */
+const uint8_t DIRECTION_LINES_MASK = 0x0f;
+
+inline uint8_t readDirectionLines()
+{
+    C1351_IO io_pin;
+
+    return (uint8_t)io_pin.up_btn2.read() << 0 |
+           (uint8_t)io_pin.down.read() << 1 |
+           (uint8_t)io_pin.left.read() << 2 |
+           (uint8_t)io_pin.right.read() << 3;
+}
+
+
 /*  C1351 mouse interface.
  *
  *  setModeSync() and setModeRead() are used to read X and Y positions of the mouse.
@@ -77,6 +97,10 @@ public:
 
     /* Call once at the beginning of the program to initialize. */
     void init();
+    /* Stop reading, and release the POTX and POTY lines. Ends the current
+     * read cycle, see isCaptureValid(). Call init() to start again.
+     */
+    void stop();
     /* Synchronize the C1351 and initiate a read cycle, start capture timers. */
     void setModeSync();
     /* Prepare for input capture event. */
@@ -91,22 +115,40 @@ public:
     MouseVelocity getVelocityY() const;
     bool getLeftButtonValue() const;
     bool getRightButtonValue() const;
+    /* True if the C1351 answered in the read cycle ended by the last
+     * setModeSync() or stop()
+     */
+    bool isCaptureValid() const;
+    /* Time of the later POT edge after the sync phase, in microseconds, in
+     * the read cycle ended by the last setModeSync() if it was valid
+     */
+    uint16_t getLatestEdgeUs() const;
 
 protected:
     C1351_IO io_pin;
 
+    volatile bool cycleStarted = false;
+    volatile bool captureValid = false;
+    uint16_t latestEdgeUs = 0;
+    // false until a reading follows a valid one, so that no movement is
+    // computed across gaps
+    volatile bool potValuesValid = false;
     volatile PotValue potXValue = 0;
     volatile PotValue potYValue = 0;
     volatile PotValue potXValueOld = 0;
     volatile PotValue potYValueOld = 0;
     volatile MouseVelocity velocityX = 0;
     volatile MouseVelocity velocityY = 0;
-    volatile int16_t velocityAccumX = 0;
-    volatile int16_t velocityAccumY = 0;
+    volatile int32_t velocityAccumX = 0;
+    volatile int32_t velocityAccumY = 0;
     volatile bool buttonLeftPressed = false;
     volatile bool buttonRightPressed = false;
+    // smoothing filter state, in 1/256 mouse counts
+    int32_t filterStateX = 0;
+    int32_t filterStateY = 0;
 
     void updatePotValues();
+    void updateLatestEdge();
     void accumulateVelocities();
     void setPotsOutputLow();
     void setPotsInput();
@@ -115,6 +157,197 @@ protected:
     void updateButtons();
 
     int16_t potValueToVelocity(PotValue oldVal, PotValue newVal);
+    static MouseVelocity clampVelocity(int32_t velocity);
+    MouseVelocity applyFilter(int32_t& state, MouseVelocity velocity);
+
+};
+
+
+/*  Amiga or Atari ST quadrature mouse interface.
+ *
+ *  Movement is decoded in the background by the line interrupts (see
+ *  quadrature.hpp). The left button is on DB9 pin 6 and the right button on
+ *  DB9 pin 9, as on the C1351.
+ */
+class QuadratureInterface {
+
+public:
+    /* Start decoding. input_mode is INPUT_MODE_AMIGA or INPUT_MODE_ATARI_ST. */
+    void init(uint8_t input_mode);
+    /* Stop decoding */
+    void stop();
+    /* Call regularly to update mouse state, like C1351Interface::update() */
+    void update();
+
+    MouseVelocity getVelocityX() const;
+    MouseVelocity getVelocityY() const;
+    bool getLeftButtonValue() const;
+    bool getRightButtonValue() const;
+
+protected:
+    C1351_IO io_pin;
+
+    MouseVelocity velocityX = 0;
+    MouseVelocity velocityY = 0;
+    bool buttonLeftPressed = false;
+    bool buttonRightPressed = false;
+
+};
+
+
+/*  Joystick interface, for the C1350 and the C1351 in joystick mode.
+ *
+ *  The direction lines and buttons are sampled once per read cycle with
+ *  scan(), and a change is only accepted after it has been stable for
+ *  JOYSTICK_DEBOUNCE_CYCLES samples. Fire is DB9 pin 6 and the second
+ *  button DB9 pin 9.
+ *
+ *  The joystick can be reported as a gamepad (getDirectionX/Y) or as
+ *  mouse movement with mouse-keys style acceleration (getVelocityX/Y), see
+ *  AdapterSettings.JoystickOutput.
+ */
+const uint8_t JOYSTICK_DEBOUNCE_CYCLES = 8;  // 4 ms
+
+class JoystickInterface {
+
+public:
+    void init();
+    /* Call once per read cycle to sample the inputs */
+    void scan();
+    /* Call regularly to update mouse state, like C1351Interface::update() */
+    void update();
+
+    /* -1 (left/up), 0 or 1 (right/down) */
+    int8_t getDirectionX() const;
+    int8_t getDirectionY() const;
+    MouseVelocity getVelocityX() const;
+    MouseVelocity getVelocityY() const;
+    bool getLeftButtonValue() const;
+    bool getRightButtonValue() const;
+
+protected:
+    C1351_IO io_pin;
+
+    // pressed inputs, JOYSTICK_* bits
+    uint8_t pressed = 0;
+    uint8_t candidate = 0;
+    uint8_t debounceCount = 0;
+    // mouse keys speed and position, in 1/16 counts
+    uint16_t speed = 0;
+    uint8_t distance = 0;
+    MouseVelocity velocityX = 0;
+    MouseVelocity velocityY = 0;
+
+    uint8_t readInputs();
+
+};
+
+
+/*  Paddle interface, for a pair of C64 paddles.
+ *
+ *  Paddles are potentiometers that charge the capacitors on POTX and POTY,
+ *  so they are read with the same sync and read cycle as the C1351 (see
+ *  C1351Interface), and the charge time is the position. Readings are
+ *  averaged over 2^AdapterSettings.PaddleAverageShift cycles, and scaled
+ *  to 0 - PADDLE_VALUE_MAX with AdapterSettings.PaddleRange as full scale.
+ *
+ *  The fire button of the POTX paddle is on DB9 pin 3 (left), and that of
+ *  the POTY paddle on DB9 pin 4 (right).
+ */
+const uint16_t PADDLE_VALUE_MAX = 1023;
+
+class PaddleInterface {
+
+public:
+    void init();
+    void stop();
+    /* Same as C1351Interface::setModeSync() and setModeRead() */
+    void setModeSync();
+    void setModeRead();
+    /* Call regularly to update the paddle values */
+    void update();
+
+    /* 0 - PADDLE_VALUE_MAX */
+    uint16_t getValueX() const;
+    uint16_t getValueY() const;
+    /* Averaged charge times, in capture timer ticks */
+    uint16_t getChargeX() const;
+    uint16_t getChargeY() const;
+    /* True if all readings of the last average were within the paddle
+     * range, false if a line did not charge in time
+     */
+    bool isInRange() const;
+    bool getFireXValue() const;
+    bool getFireYValue() const;
+
+protected:
+    C1351_IO io_pin;
+
+    bool cycleStarted = false;
+    uint32_t sumX = 0;
+    uint32_t sumY = 0;
+    uint8_t sampleCount = 0;
+    bool blockInRange = true;
+    volatile bool inRange = false;
+    // averaged charge times, in capture timer ticks
+    volatile uint16_t chargeX = 0;
+    volatile uint16_t chargeY = 0;
+    uint16_t valueX = 0;
+    uint16_t valueY = 0;
+    bool fireXPressed = false;
+    bool fireYPressed = false;
+
+    uint16_t readChargeTime(TimerNumber n, uint16_t range);
+
+};
+
+
+/*  Absolute pointer for pot-based touch tablets such as the Koala Pad,
+ *  read with the PaddleInterface.
+ *
+ *  While the pad is not touched, its pots read beyond the paddle range and
+ *  the position is held. The lowest and highest charge times seen on each
+ *  axis are learned while the pad is used, and mapped onto 0 -
+ *  TABLET_POSITION_MAX, so the pointer reaches the edges of the screen once
+ *  each edge of the pad has been touched. Positions are smoothed with
+ *  AdapterSettings.FilterShift, except when the pad is first touched.
+ *
+ *  The buttons are the paddle fire buttons.
+ */
+const uint16_t TABLET_POSITION_MAX = 32767;
+// Smallest learned range, in capture timer ticks, that is mapped
+const uint16_t TABLET_MIN_SPAN = 64;
+
+class TabletInterface {
+
+public:
+    /* Forget the learned range */
+    void init();
+    /* Call after PaddleInterface::update() */
+    void update(const PaddleInterface& paddles);
+
+    /* 0 - TABLET_POSITION_MAX */
+    uint16_t getPositionX() const;
+    uint16_t getPositionY() const;
+    bool getLeftButtonValue() const;
+    bool getRightButtonValue() const;
+
+protected:
+    uint16_t minX = 0xffff;
+    uint16_t maxX = 0;
+    uint16_t minY = 0xffff;
+    uint16_t maxY = 0;
+    bool wasInRange = false;
+    // smoothing filter state, in 1/256 positions
+    uint32_t filterStateX = 0;
+    uint32_t filterStateY = 0;
+    uint16_t positionX = TABLET_POSITION_MAX / 2;
+    uint16_t positionY = TABLET_POSITION_MAX / 2;
+    bool buttonLeftPressed = false;
+    bool buttonRightPressed = false;
+
+    static uint16_t scale(uint16_t charge, uint16_t min, uint16_t max);
+    uint16_t smooth(uint32_t& state, uint16_t position);
 
 };
 
@@ -62,7 +62,38 @@ extern "C"
  */
 #define AXIS_MIN -32767
 #define AXIS_MAX 32767
-#define BUTTONS 2
+#define BUTTONS 3
+
+/* The mouse report ends with an int8_t wheel axis. While the host has
+ * enabled the Resolution Multiplier feature (REPORT_ID_ResolutionMultiplier),
+ * the wheel is reported in 1 / WHEEL_RESOLUTION_MULTIPLIER detents.
+ */
+#define WHEEL_RESOLUTION_MULTIPLIER 8
+
+/* Gamepad report, used for joysticks:
+ *
+ * typedef struct {
+ *   uint8_t Button; // Pressed buttons bitmask
+ *   int16_t X; // -GAMEPAD_AXIS_MAX (left) to GAMEPAD_AXIS_MAX (right)
+ *   int16_t Y; // -GAMEPAD_AXIS_MAX (up) to GAMEPAD_AXIS_MAX (down)
+ * } Gamepad_Report;
+ */
+#define GAMEPAD_AXIS_MAX 32767
+#define GAMEPAD_BUTTONS 2
+
+/* Absolute pointer report, used for touch tablets:
+ *
+ * typedef struct {
+ *   uint8_t Button; // Pressed buttons bitmask
+ *   uint16_t X; // 0 (left) to TABLET_AXIS_MAX (right)
+ *   uint16_t Y; // 0 (top) to TABLET_AXIS_MAX (bottom)
+ * } Tablet_Report;
+ */
+#define TABLET_AXIS_MAX 32767
+
+
+/* HID usage page (0xFF00 | n) of the vendor-defined settings collection */
+#define SETTINGS_VENDOR_PAGE 0x13
 
 
 #define VENDOR_ID 0x03eb
@@ -95,6 +126,17 @@ extern "C"
 /** Size in bytes of the Mouse HID reporting IN endpoint. */
 #define MOUSE_EPSIZE                   8
 
+#ifdef ENABLE_KEYBOARD
+/** Endpoint address of the Keyboard HID reporting IN endpoint. */
+#define KEYBOARD_EPADDR                (ENDPOINT_DIR_IN  | 5)
+
+/** Size in bytes of the Keyboard HID reporting IN endpoint. */
+#define KEYBOARD_EPSIZE                8
+
+/** Number of keys in the keyboard report. */
+#define KEYBOARD_KEYS                  6
+#endif
+
 /* Type Defines: */
 /** Type define for the device configuration descriptor structure. This must be defined in the
     application code, as the configuration descriptor contains several sub-descriptors which
@@ -120,6 +162,12 @@ typedef struct {
     USB_Descriptor_Interface_t               HID_Interface;
     USB_HID_Descriptor_HID_t                 HID_MouseHID;
     USB_Descriptor_Endpoint_t                HID_ReportINEndpoint;
+#ifdef ENABLE_KEYBOARD
+    // Keyboard HID Interface
+    USB_Descriptor_Interface_t               HID_KeyboardInterface;
+    USB_HID_Descriptor_HID_t                 HID_KeyboardHID;
+    USB_Descriptor_Endpoint_t                HID_KeyboardReportINEndpoint;
+#endif
 } USB_Descriptor_Configuration_t;
 
 /** Enum for the device interface descriptor IDs within the device. Each interface descriptor
@@ -134,6 +182,10 @@ enum InterfaceDescriptors_t {
 #else
     INTERFACE_ID_Mouse = 0, /**< Mouse interface descriptor ID */
 #endif
+#ifdef ENABLE_KEYBOARD
+    INTERFACE_ID_Keyboard, /**< Keyboard interface descriptor ID */
+#endif
+    INTERFACE_COUNT /**< Number of interfaces */
 };
 
 /** Enum for the device string descriptor IDs within the device. Each string descriptor should
@@ -146,6 +198,17 @@ enum StringDescriptors_t {
     STRING_ID_Product      = 2, /**< Product string ID */
 };
 
+/** Enum for the HID report IDs used in the mouse interface's report descriptor. */
+enum MouseReportIDs_t {
+    REPORT_ID_Mouse    = 1, /**< Mouse movement and button input report ID */
+    REPORT_ID_Settings = 2, /**< Vendor-defined adapter settings feature report ID, see settings.h */
+    REPORT_ID_SettingsCommand = 3, /**< Vendor-defined settings command feature report ID, see settings.h */
+    REPORT_ID_Gamepad  = 4, /**< Gamepad axes and button input report ID, for joysticks */
+    REPORT_ID_Tablet   = 5, /**< Absolute pointer input report ID, for touch tablets */
+    REPORT_ID_ResolutionMultiplier = 6, /**< Wheel resolution multiplier feature report ID */
+    REPORT_ID_Status   = 7, /**< Vendor-defined adapter status feature report ID, see status.h */
+};
+
 /* Function Prototypes: */
 uint16_t CALLBACK_USB_GetDescriptor(const uint16_t wValue,
                                     const uint16_t wIndex,
@@ -0,0 +1,97 @@
+/*  Automatic detection of the device connected to the DB9 port.
+
+    Used when AdapterSettings.InputMode is INPUT_MODE_AUTO. The detector is
+    fed once per C1351 read cycle with the state of the direction lines and,
+    when the POTX/POTY lines were read, whether a C1351 answered:
+
+    - A C1351 in proportional mode answers every read. It is assumed to be
+      gone after DETECT_C1351_LOST_CYCLES reads without an answer.
+    - Quadrature mice pull opposing directions (DB9 pins 1 and 2, or 3 and
+      4) low at the same time, which a joystick cannot do. The Amiga and
+      Atari ST pinouts are told apart by decoding the first line changes
+      with both, and keeping the one that gives consistent movement.
+    - Anything else that pulls a direction line low is a joystick, or a
+      C1351 in joystick mode.
+    - A port whose lines have been released and unchanged for
+      DETECT_IDLE_CYCLES, with no button pressed, is treated as empty. A
+      button pressed then selects the quadrature mouse or joystick used
+      before again, which was only left still. While empty, the POTX/POTY
+      lines are only probed every DETECT_PROBE_INTERVAL cycles. They are
+      not probed while a joystick is used, since a C1351 in proportional
+      mode keeps the direction lines released, and is detected after the
+      port is empty.
+*/
+
+#pragma once
+#ifndef DETECTION_HPP
+#define DETECTION_HPP
+
+#include <stdint.h>
+
+
+namespace c1351_mouse {
+
+enum InputDevice {
+    DEVICE_NONE = 0,
+    DEVICE_C1351,
+    DEVICE_JOYSTICK,
+    DEVICE_AMIGA,
+    DEVICE_ATARI_ST,
+    DEVICE_PADDLES,  // only with INPUT_MODE_PADDLES
+    DEVICE_TABLET,   // only with INPUT_MODE_TABLET
+};
+
+/* Consecutive answered reads needed to detect a C1351 */
+const uint8_t DETECT_C1351_CYCLES = 3;
+/* Consecutive unanswered reads after which a C1351 is assumed unplugged */
+const uint8_t DETECT_C1351_LOST_CYCLES = 32;
+/* Cycles with all lines released and unchanged, and no button pressed,
+ * before the port is treated as empty (~2 s)
+ */
+const uint16_t DETECT_IDLE_CYCLES = 4000;
+/* Cycles between POTX/POTY probes while no C1351 is detected (~16 ms) */
+const uint8_t DETECT_PROBE_INTERVAL = 32;
+/* Line changes decoded to choose between the Amiga and Atari ST pinouts */
+const uint8_t DETECT_LAYOUT_CHANGES = 24;
+
+
+class InputDetector {
+
+public:
+    /* Call once per C1351 read cycle. pots_read is true if the POTX/POTY
+     * lines were read in this cycle, and capture_valid is true if a C1351
+     * answered. lines is the state of the direction lines, see
+     * readDirectionLines(), and button_pressed is true if DB9 pin 6, or
+     * pin 9 while not probing, is low. Returns the detected device.
+     */
+    uint8_t update(bool pots_read, bool capture_valid, uint8_t lines, bool button_pressed);
+    uint8_t getDevice() const;
+    /* True while the POTX/POTY lines should be probed for a C1351 */
+    bool isProbing() const;
+
+protected:
+    uint8_t device = DEVICE_NONE;
+    uint8_t lastLines = 0x0f;
+    // consecutive answered reads, or unanswered reads while a C1351 is used
+    uint8_t captureCount = 0;
+    uint16_t idleCount = 0;
+    // pinout of the last quadrature mouse, DEVICE_NONE if unknown
+    uint8_t lastQuadratureDevice = DEVICE_NONE;
+    // quadrature mouse or joystick that went idle, DEVICE_NONE if none
+    uint8_t idleDevice = DEVICE_NONE;
+    // line changes still to decode before choosing a pinout, 0 if not
+    // choosing
+    uint8_t layoutChanges = 0;
+    int16_t amigaX = 0;
+    int16_t amigaY = 0;
+    int16_t atariX = 0;
+    int16_t atariY = 0;
+
+    void setDevice(uint8_t new_device);
+    void decodeLayouts(uint8_t prev_lines, uint8_t lines);
+    uint8_t chooseLayout() const;
+
+};
+
+}
+#endif
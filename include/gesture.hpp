@@ -0,0 +1,47 @@
+/*  Mouse gestures.
+
+    While the buttons in AdapterSettings.GestureButtons are held, pointer
+    movement is withheld and summed. When they are released after the
+    mouse moved at least GESTURE_FLICK_DISTANCE counts, the main direction
+    of the movement selects a KEY_BINDING_FLICK_* keystroke. If it moved
+    less, the buttons are sent as a click instead.
+*/
+
+#pragma once
+#ifndef GESTURE_HPP
+#define GESTURE_HPP
+
+#include <stdint.h>
+
+
+namespace c1351_mouse {
+
+/* Movement, in mouse counts, that makes a flick */
+const uint8_t GESTURE_FLICK_DISTANCE = 64;
+/* Returned by GestureDetector::update() when no gesture was made */
+const uint8_t GESTURE_NONE = 0xff;
+
+
+class GestureDetector {
+
+public:
+    /* Call once per report. buttons has bit BUTTON_INDEX_* set for each
+     * pressed button. Takes the withheld movement out of x and y and the
+     * withheld buttons out of buttons. Returns the KEY_BINDING_FLICK_* of
+     * a completed flick, or GESTURE_NONE.
+     */
+    uint8_t update(int16_t& x, int16_t& y, uint8_t& buttons);
+
+protected:
+    bool active = false;
+    // buttons withheld while the gesture buttons are held
+    uint8_t heldButtons = 0;
+    int16_t sumX = 0;
+    int16_t sumY = 0;
+
+    uint8_t getFlick() const;
+
+};
+
+}
+#endif
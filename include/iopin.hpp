@@ -19,6 +19,12 @@
 
      PortA::write(0xf7);
 
+ Example (pin group):
+
+    PinGroup<Pin<PortC, 7>, Pin<PortD, 4>> pots;
+
+    pots.setDirectionIn();  // one DDRC and one DDRD write, back to back
+
 ******************************************************************************/
 
 #pragma once
@@ -31,6 +37,9 @@
 template<typename PORT, uint8_t PIN>
 class Pin {
 public:
+    typedef PORT Port;
+    static const uint8_t BIT = PIN;
+
     static inline void high()
     {
         PORT::setPins(_BV(PIN));
@@ -42,7 +51,9 @@ public:
     inline void setDirectionIn(bool enable_pullup = false)
     {
         PORT::setDirectionIn(_BV(PIN));
-        PORT::setPins((uint8_t)enable_pullup << PIN);
+        if (enable_pullup) {
+            PORT::setPins(_BV(PIN));
+        }
     }
     static inline void setDirectionOut()
     {
@@ -68,6 +79,7 @@ static inline void    write(uint8_t value)   {PORT_NAME = value;}\
 static inline void    setDirectionOut(uint8_t value)  {DDR_NAME |= value;}\
 static inline void    setDirectionIn(uint8_t value){DDR_NAME &= ~value;}\
 static inline void    setDirection(uint8_t value){DDR_NAME = value;}\
+static inline uint8_t readDirection()        {return DDR_NAME;}\
 };
 
 
@@ -110,4 +122,109 @@ static inline void    setDirection(uint8_t value){DDR_NAME = value;}\
 #ifdef PORTR
     DECLARE_PORT(PortR, PORTR, DDRR, PINR)
 #endif
+
+
+template<typename A, typename B>
+struct IsSameType {
+    static const bool value = false;
+};
+
+template<typename A>
+struct IsSameType<A, A> {
+    static const bool value = true;
+};
+
+
+/* Bits of the pins that are on port P */
+template<typename P, typename... Pins>
+constexpr uint8_t portMask()
+{
+    const uint8_t bits[] = {0, (IsSameType<typename Pins::Port, P>::value ?
+                                (uint8_t)_BV(Pins::BIT) : (uint8_t)0)...};
+    uint8_t mask = 0;
+    for (uint8_t bit : bits) {
+        mask |= bit;
+    }
+    return mask;
+}
+
+
+/* Pins that are changed together. The masks of each port are computed at
+ * compile time. An operation first reads and modifies the register of
+ * every port, then writes them back to back, so pins on different ports
+ * change within one cycle of each other, and pins on the same port at
+ * once. Like any read-modify-write, it must not be interrupted by code
+ * that writes the same ports.
+ */
+template<typename... Pins>
+class PinGroup {
+public:
+    static inline void high()
+    {
+        EachPort<SetPins, Pins...>::apply();
+    }
+    static inline void low()
+    {
+        EachPort<ClearPins, Pins...>::apply();
+    }
+    static inline void setDirectionIn()
+    {
+        EachPort<DirectionIn, Pins...>::apply();
+    }
+    static inline void setDirectionOut()
+    {
+        EachPort<DirectionOut, Pins...>::apply();
+    }
+
+private:
+    struct SetPins {
+        template<typename P>
+        static inline uint8_t modify(uint8_t mask) { return P::read() | mask; }
+        template<typename P>
+        static inline void write(uint8_t value) { P::write(value); }
+    };
+    struct ClearPins {
+        template<typename P>
+        static inline uint8_t modify(uint8_t mask) { return P::read() & ~mask; }
+        template<typename P>
+        static inline void write(uint8_t value) { P::write(value); }
+    };
+    struct DirectionIn {
+        template<typename P>
+        static inline uint8_t modify(uint8_t mask) { return P::readDirection() & ~mask; }
+        template<typename P>
+        static inline void write(uint8_t value) { P::setDirection(value); }
+    };
+    struct DirectionOut {
+        template<typename P>
+        static inline uint8_t modify(uint8_t mask) { return P::readDirection() | mask; }
+        template<typename P>
+        static inline void write(uint8_t value) { P::setDirection(value); }
+    };
+
+    /* Modifies the port of each pin that is the last one on its port, then
+     * the remaining pins, then writes in reverse order
+     */
+    template<typename Op, typename... Rest>
+    struct EachPort {
+        static inline void apply() {}
+    };
+
+    template<typename Op, typename First, typename... Rest>
+    struct EachPort<Op, First, Rest...> {
+        static inline void apply()
+        {
+            typedef typename First::Port P;
+
+            if (portMask<P, Rest...>()) {
+                EachPort<Op, Rest...>::apply();
+                return;
+            }
+            uint8_t value = Op::template modify<P>(portMask<P, Pins...>());
+            EachPort<Op, Rest...>::apply();
+            Op::template write<P>(value);
+        }
+    };
+};
+
 #endif //IOPIN_H
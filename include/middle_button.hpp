@@ -0,0 +1,43 @@
+/*  Middle button emulation.
+
+    Pressing the left and right buttons together, within
+    AdapterSettings.ChordWindow milliseconds of each other, presses the
+    middle button until both are released.
+
+    To detect the chord, the first button of a press is withheld from the
+    host for at most the window. If it is released before the window ends,
+    the click is sent right away, and if the window ends first, the button
+    is sent as pressed, so single clicks are delayed by no more than the
+    window, and drags start at most the window late.
+*/
+
+#pragma once
+#ifndef MIDDLE_BUTTON_HPP
+#define MIDDLE_BUTTON_HPP
+
+#include <stdint.h>
+
+
+namespace c1351_mouse {
+
+class MiddleButtonEmulator {
+
+public:
+    /* Call once per report, elapsed_us is the time since the last call.
+     * buttons has bit BUTTON_INDEX_* set for each pressed button. Replaces
+     * a chord by BUTTON_INDEX_MIDDLE, and takes withheld buttons out of
+     * buttons.
+     */
+    void update(uint8_t& buttons, uint32_t elapsed_us);
+
+protected:
+    uint8_t state = 0;
+    // the button pressed first while waiting for a chord
+    uint8_t firstButton = 0;
+    // microseconds waited for a chord
+    uint32_t elapsedUs = 0;
+
+};
+
+}
+#endif
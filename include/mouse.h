@@ -45,11 +45,15 @@ extern "C"
 #include <avr/interrupt.h>
 #include <avr/io.h>
 #include <avr/power.h>
+#include <avr/sleep.h>
 #include <avr/wdt.h>
 #include <stdbool.h>
 #include <string.h>
 
 #include "descriptors.h"
+#include "reports.h"
+#include "settings.h"
+#include "settings_store.h"
 
 //#include <LUFA/Drivers/Board/Joystick.h>
 #include <LUFA/Drivers/Board/LEDs.h>
@@ -58,18 +62,6 @@ extern "C"
 #include <LUFA/Platform/Platform.h>
 
 
-#if ((AXIS_MIN >= -128) && (AXIS_MAX <= 127))
-typedef USB_MouseReport_Data_t Mouse_Report;
-#elif ((AXIS_MIN >= -32768) && (AXIS_MAX <= 32767))
-typedef struct {
-  uint8_t Button; // Pressed buttons bitmask
-  int16_t X; // X axis value
-  int16_t Y; // Y axis value
-} Mouse_Report;
-#else
-error("AXIS_MIN and AXIS_MAX must fit within int8_t or int16_t");
-#endif
-
 /* Macros: */
 /** LED mask for the library LED driver, to indicate that the USB interface is not ready. */
 #define LEDMASK_USB_NOTREADY      LEDS_LED1
@@ -83,19 +75,41 @@ error("AXIS_MIN and AXIS_MAX must fit within int8_t or int16_t");
 /** LED mask for the library LED driver, to indicate that an error has occurred in the USB interface. */
 #define LEDMASK_USB_ERROR        (LEDS_LED1 | LEDS_LED3)
 
+/** LED mask for the library LED driver, to indicate that the USB bus is suspended. */
+#define LEDMASK_USB_SUSPENDED     LEDS_NO_LEDS
+
 void SetupHardware();
 void setupUsbMouse();
-/* Set values of USB mouse */
-void setUsbMouse(int8_t x, int8_t y, uint8_t button);
-/* Call after setUsbMouse to send to USB */
+/* Wheel units per detent chosen by the host, 1 or WHEEL_RESOLUTION_MULTIPLIER */
+uint8_t getWheelMultiplier();
+/* Call after setUsbMouse (see reports.h) to send to USB */
 void handleUsb();
+/* Returns true while the host has the USB bus suspended */
+bool isUsbSuspended();
+/* Ask the host to wake up from suspend. Only has an effect while suspended
+ * and if the host has enabled remote wakeup.
+ */
+void requestRemoteWakeup();
+/* Call from the main loop. While suspended, sends a pending remote wakeup or
+ * puts the CPU to sleep until the next interrupt.
+ */
+void handleUsbSuspend();
 
 #ifdef ENABLE_VIRTUAL_SERIAL
 void serialPrintNum(int16_t);
 #endif
 
+#ifdef ENABLE_KEYBOARD
+/* Queue a keystroke (press and release) for the keyboard interface. Returns
+ * false if the queue is full.
+ */
+bool queueKeyStroke(uint8_t modifier, uint8_t key_code);
+#endif
+
 void EVENT_USB_Device_Connect();
 void EVENT_USB_Device_Disconnect();
+void EVENT_USB_Device_Suspend();
+void EVENT_USB_Device_WakeUp();
 void EVENT_USB_Device_ConfigurationChanged();
 void EVENT_USB_Device_ControlRequest();
 void EVENT_USB_Device_StartOfFrame();
@@ -0,0 +1,117 @@
+/*  Quadrature mouse decoding (Amiga and Atari ST mice)
+
+    Amiga and Atari ST mice put two quadrature signal pairs on DB9 pins 1-4,
+    which are the C1351 joystick lines. Pins 1-3 have interrupts (INT1,
+    PCINT1, PCINT4), pin 4 (PD7) does not. Every interrupt samples all four
+    lines and looks up the transition from the previous sample in a table,
+    which gives the step of each axis, or an error if a line pair changed
+    twice between samples.
+
+    The axis whose pairs are both on interrupt pins is decoded at full (4x)
+    resolution. The other axis only counts edges of its pin 1-3 line (2x),
+    with the direction taken from the level of pin 4, and its steps are
+    doubled so both axes move at the same rate.
+
+    To use, call initQuadrature() with the mouse type, and collect the
+    movement since the last call with takeQuadratureCounts().
+*/
+
+#pragma once
+#ifndef QUADRATURE_HPP
+#define QUADRATURE_HPP
+
+#include <avr/pgmspace.h>
+#include <stdint.h>
+
+#include "settings.h"
+
+
+namespace c1351_mouse {
+
+/* Bits of the sampled line state, one per DB9 pin, see readDirectionLines() */
+enum QuadratureLine {
+    QUAD_LINE_1 = 0,  // Amiga V,  Atari XB
+    QUAD_LINE_2,      // Amiga H,  Atari XA
+    QUAD_LINE_3,      // Amiga VQ, Atari YA
+    QUAD_LINE_4,      // Amiga HQ, Atari YB (no interrupt)
+};
+
+/* Flags of a transition table entry */
+enum {
+    QUAD_X_INC = 1 << 0,
+    QUAD_X_DEC = 1 << 1,
+    QUAD_Y_INC = 1 << 2,
+    QUAD_Y_DEC = 1 << 3,
+    QUAD_ERROR = 1 << 4,
+};
+
+/* An axis is decoded from lines a and b. The axis counts up when a leads b. */
+struct QuadratureAxis {
+    uint8_t a;
+    uint8_t b;
+};
+
+/* Only the b line may be QUAD_LINE_4 */
+constexpr bool isHalfAxis(QuadratureAxis axis)
+{
+    return axis.b == QUAD_LINE_4;
+}
+
+
+/* Position within a quadrature cycle: 00, 10, 11, 01 (a, b) */
+constexpr uint8_t quadraturePosition(bool a, bool b)
+{
+    return a ? (b ? 2 : 1) : (b ? 3 : 0);
+}
+
+
+constexpr uint8_t axisStep(QuadratureAxis axis, uint8_t prev, uint8_t cur,
+                           uint8_t inc, uint8_t dec)
+{
+    bool prev_a = prev & (1 << axis.a);
+    bool cur_a = cur & (1 << axis.a);
+    bool cur_b = cur & (1 << axis.b);
+    // the b line of a half axis has no interrupt, so only count edges of
+    // the a line, as if b had changed before it
+    bool prev_b = isHalfAxis(axis) ? cur_b : (bool)(prev & (1 << axis.b));
+
+    uint8_t diff = (quadraturePosition(cur_a, cur_b) -
+                    quadraturePosition(prev_a, prev_b)) & 3;
+
+    return diff == 1 ? inc : diff == 3 ? dec : diff == 2 ? QUAD_ERROR : 0;
+}
+
+
+struct QuadratureTable {
+    uint8_t step[256];  // indexed by previous line state << 4 | line state
+};
+
+
+constexpr QuadratureTable makeQuadratureTable(QuadratureAxis x, QuadratureAxis y)
+{
+    QuadratureTable table {};
+    for (uint16_t i = 0; i < 256; i++) {
+        uint8_t prev = i >> 4;
+        uint8_t cur = i & 0x0f;
+        table.step[i] = axisStep(x, prev, cur, QUAD_X_INC, QUAD_X_DEC) |
+                        axisStep(y, prev, cur, QUAD_Y_INC, QUAD_Y_DEC);
+    }
+    return table;
+}
+
+
+/* Set up the lines and start decoding. input_mode is INPUT_MODE_AMIGA or
+ * INPUT_MODE_ATARI_ST.
+ */
+void initQuadrature(uint8_t input_mode);
+/* Stop decoding and disable the line interrupts */
+void stopQuadrature();
+/* Get and reset the movement since the last call, in 4x counts */
+void takeQuadratureCounts(int16_t& x, int16_t& y);
+/* Number of invalid transitions (missed edges) since initQuadrature() */
+uint16_t getQuadratureErrors();
+/* Transition table entry (QUAD_* flags) for the given mouse type */
+uint8_t getQuadratureStep(uint8_t input_mode, uint8_t prev_lines, uint8_t lines);
+
+}
+#endif
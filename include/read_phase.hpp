@@ -0,0 +1,69 @@
+/*  Adaptive C1351 read phase.
+
+    A C1351 read cycle is a sync phase, in which POTX and POTY are held low
+    for 256 uS, followed by a read phase, in which the C1351 raises them
+    after a time that encodes its position. The C1351 usually answers well
+    before the 256 uS read phase ends.
+
+    With AdapterSettings.ReadPhaseMargin set, the read phase ends
+    ReadPhaseMargin uS after the latest edge of the last READ_PHASE_WINDOW
+    read cycles, which raises the read cycle rate. A later edge lengthens the
+    read phase at once. A cycle with a missing edge restores the full read
+    phase, READ_PHASE_TIMEOUT_US, until a window of answered cycles has been
+    seen again.
+
+    The tuner measures the shortest read phase that ran for a whole window
+    without a missing edge. The host reads it with the status report (see
+    status.h), which gives the highest stable read cycle rate.
+*/
+
+#pragma once
+#ifndef READ_PHASE_HPP
+#define READ_PHASE_HPP
+
+#include <stdint.h>
+
+#include "status.h"
+
+
+namespace c1351_mouse {
+
+/* Full read phase, the length of the sync phase */
+const uint16_t READ_PHASE_TIMEOUT_US = 256;
+/* Shortest read phase */
+const uint16_t READ_PHASE_MIN_US = 32;
+/* Read cycles per tuning window */
+const uint8_t READ_PHASE_WINDOW = 64;
+
+
+class ReadPhaseTuner {
+
+public:
+    /* Call at the end of each C1351 read cycle. answered is false if an
+     * edge is missing, latest_edge_us is the time of the later edge after
+     * the sync phase.
+     */
+    void update(bool answered, uint16_t latest_edge_us);
+    /* Length of the next read phase, in microseconds */
+    uint16_t getReadUs() const;
+    /* Fill the read phase fields of the status report */
+    void getStatus(AdapterStatus& status) const;
+
+protected:
+    uint16_t readUs = READ_PHASE_TIMEOUT_US;
+    // latest edge and longest read phase in the current window
+    uint16_t windowEdgeUs = 0;
+    uint16_t windowReadUs = 0;
+    uint8_t windowCycles = 0;
+    // latest edge of the last complete window
+    uint16_t latestEdgeUs = 0;
+    uint16_t stableReadUs = 0;
+    uint16_t missedEdges = 0;
+
+    void restartWindow();
+    static uint16_t limit(uint16_t read_us);
+
+};
+
+}
+#endif
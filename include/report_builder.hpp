@@ -0,0 +1,47 @@
+/*  USB mouse report from the state of a mouse interface.
+
+    MouseReportBuilder applies the middle button and scroll wheel
+    emulation, the key bindings and AdapterSettings.ButtonMap to the
+    movement and buttons of the mouse in use, and sets the result with
+    setUsbMouse() (see reports.h). The host tools build it as well (see
+    tools/Makefile), without ENABLE_KEYBOARD.
+*/
+
+#pragma once
+#ifndef REPORT_BUILDER_HPP
+#define REPORT_BUILDER_HPP
+
+#include <stdint.h>
+
+#include "controller.hpp"
+#include "gesture.hpp"
+#include "middle_button.hpp"
+#include "scroll.hpp"
+
+
+namespace c1351_mouse {
+
+class MouseReportBuilder {
+
+public:
+    /* Call once per report, interval_us after the last one.
+     * wheel_multiplier is 1, or WHEEL_RESOLUTION_MULTIPLIER if the host
+     * enabled high-resolution scrolling.
+     */
+    void update(MouseVelocity x, MouseVelocity y, bool left, bool right,
+                uint8_t wheel_multiplier, uint32_t interval_us);
+
+protected:
+    MiddleButtonEmulator middleButton;
+    ScrollEmulator scroll;
+#ifdef ENABLE_KEYBOARD
+    GestureDetector gesture;
+    bool middleWasPressed = false;
+
+    void sendKeyBindings(MouseVelocity& x, MouseVelocity& y, uint8_t& pressed);
+#endif
+
+};
+
+}
+#endif
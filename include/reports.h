@@ -0,0 +1,91 @@
+/*  Contents of the IN reports of the mouse interface.
+
+    The mouse, gamepad and tablet reports are set with setUsbMouse(),
+    setUsbGamepad() and setUsbTablet(), and taken by the HID class driver
+    with createMouseInterfaceReport(). This part does not use the USB
+    driver, so that the host tools build it unchanged (see tools/Makefile)
+    and send the same reports as the adapter.
+*/
+
+#pragma once
+#ifndef REPORTS_H
+#define REPORTS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "descriptors.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+#if ((AXIS_MIN >= -128) && (AXIS_MAX <= 127))
+typedef struct {
+  uint8_t Button; // Pressed buttons bitmask
+  int8_t X; // X axis value
+  int8_t Y; // Y axis value
+  int8_t Wheel; // Wheel movement
+} ATTR_PACKED Mouse_Report;
+#elif ((AXIS_MIN >= -32768) && (AXIS_MAX <= 32767))
+typedef struct {
+  uint8_t Button; // Pressed buttons bitmask
+  int16_t X; // X axis value
+  int16_t Y; // Y axis value
+  int8_t Wheel; // Wheel movement
+} ATTR_PACKED Mouse_Report;
+#else
+error("AXIS_MIN and AXIS_MAX must fit within int8_t or int16_t");
+#endif
+
+typedef struct {
+  uint8_t Button; // Pressed buttons bitmask
+  int16_t X; // X axis value
+  int16_t Y; // Y axis value
+} ATTR_PACKED Gamepad_Report;
+
+typedef struct {
+  uint8_t Button; // Pressed buttons bitmask
+  uint16_t X; // X position
+  uint16_t Y; // Y position
+} ATTR_PACKED Tablet_Report;
+
+/* Boot protocol mouse report, without report ID */
+typedef struct {
+  uint8_t Button; // Buttons 1 - 3
+  int8_t X;
+  int8_t Y;
+} ATTR_PACKED Boot_Mouse_Report;
+
+#define MAX_SIZE(a, b) ((a) > (b) ? (a) : (b))
+/* Largest report of createMouseInterfaceReport() */
+#define MAX_IN_REPORT_SIZE MAX_SIZE(MAX_SIZE(sizeof(Mouse_Report), sizeof(Gamepad_Report)), \
+                                    sizeof(Tablet_Report))
+
+
+/* Reset all reports to zero. The mouse report is sent once. */
+void initMouseReportData(void);
+/* Set values of USB mouse. Movement is sent until it has been zero once,
+ * buttons when they change.
+ */
+void setUsbMouse(int16_t x, int16_t y, int8_t wheel, uint8_t button);
+/* Set values of USB gamepad */
+void setUsbGamepad(int16_t x, int16_t y, uint8_t button);
+/* Set values of USB absolute pointer */
+void setUsbTablet(uint16_t x, uint16_t y, uint8_t button);
+/* Write the next IN report to report_data, and its ID and size. Gamepad
+ * and tablet reports are sent when they change, in between mouse reports.
+ * In boot protocol, only the mouse report is sent, as Boot_Mouse_Report.
+ * Returns true if the report must be sent, false if it is unchanged.
+ */
+bool createMouseInterfaceReport(bool boot_protocol, uint8_t* report_id, void* report_data,
+                                uint16_t* report_size);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,52 @@
+/*  Scroll wheel emulation.
+
+    While the buttons in AdapterSettings.ScrollButtons are held, Y movement
+    is reported as wheel movement instead of pointer movement. The buttons
+    are withheld from the host until the mouse moves SCROLL_START_DISTANCE
+    counts, so that pressing and releasing them without moving still sends
+    a click. If only some of the buttons of a chord are held when the mouse
+    moves, they are sent as usual, so dragging with them still works.
+
+    The wheel is reported in 1 / multiplier detents, where the multiplier is
+    1 or WHEEL_RESOLUTION_MULTIPLIER, as chosen by the host through the HID
+    Resolution Multiplier feature.
+*/
+
+#pragma once
+#ifndef SCROLL_HPP
+#define SCROLL_HPP
+
+#include <stdint.h>
+
+
+namespace c1351_mouse {
+
+/* Movement, in mouse counts, with the scroll buttons held that starts
+ * scrolling
+ */
+const uint8_t SCROLL_START_DISTANCE = 8;
+
+
+class ScrollEmulator {
+
+public:
+    /* Call once per report. buttons has bit BUTTON_INDEX_* set for each
+     * pressed button. Takes the wheel movement out of x and y and the
+     * withheld buttons out of buttons, and returns the wheel movement.
+     */
+    int8_t update(int16_t& x, int16_t& y, uint8_t& buttons, uint8_t multiplier);
+
+protected:
+    uint8_t state = 0;
+    // buttons withheld while deciding between a click and scrolling
+    uint8_t heldButtons = 0;
+    uint16_t distance = 0;
+    // wheel movement not reported yet, in mouse counts * multiplier
+    int16_t remainder = 0;
+
+    int8_t scroll(int16_t y, uint8_t multiplier);
+
+};
+
+}
+#endif
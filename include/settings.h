@@ -0,0 +1,203 @@
+/*  Runtime adapter settings.
+
+    The settings live in RAM and are read by the sampling and USB code. The
+    host can read and replace them at runtime through the vendor-defined
+    settings feature report (see REPORT_ID_Settings in descriptors.h).
+
+    The AdapterSettings struct is the wire format of that report, so this
+    header is also used by the host tools and must not depend on AVR or LUFA
+    headers. Multi-byte fields are little-endian.
+*/
+
+#pragma once
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/* Layout version of AdapterSettings. Bump whenever the layout changes. */
+#define SETTINGS_VERSION 11
+
+/* Size in bytes of the settings feature report, excluding the report ID.
+ * AdapterSettings is zero-padded to this size, which leaves room to add
+ * fields without changing the report descriptor.
+ */
+#define SETTINGS_REPORT_SIZE 48
+
+/* Largest accepted value of AdapterSettings.FilterShift */
+#define SETTINGS_MAX_FILTER_SHIFT 7
+
+/* Largest accepted value of AdapterSettings.PaddleAverageShift */
+#define SETTINGS_MAX_PADDLE_AVERAGE_SHIFT 4
+/* Longest accepted AdapterSettings.PaddleRange. Paddles are read for
+ * 512 uS after each sync.
+ */
+#define SETTINGS_MAX_PADDLE_RANGE 500
+
+/* Commands sent by the host in the settings command feature report
+ * (REPORT_ID_SettingsCommand). Reading that report returns the command that
+ * is still in progress, or SETTINGS_COMMAND_NONE.
+ */
+enum {
+    SETTINGS_COMMAND_NONE = 0,
+    SETTINGS_COMMAND_COMMIT,    // save current settings to EEPROM
+    SETTINGS_COMMAND_LOAD,      // reload settings from EEPROM
+    SETTINGS_COMMAND_DEFAULTS,  // restore defaults (EEPROM is not changed)
+};
+
+/* Pointer acceleration curves, see acceleration.hpp */
+enum {
+    ACCEL_PROFILE_FLAT = 0,  // no acceleration
+    ACCEL_PROFILE_LINEAR,
+    ACCEL_PROFILE_SIGMOID,
+    ACCEL_PROFILE_COUNT
+};
+
+/* Type of mouse connected to the DB9 port */
+enum {
+    INPUT_MODE_AUTO = 0,   // detect, see detection.hpp
+    INPUT_MODE_C1351,      // proportional mode, see controller.hpp
+    INPUT_MODE_AMIGA,      // quadrature, see quadrature.hpp
+    INPUT_MODE_ATARI_ST,   // quadrature, see quadrature.hpp
+    INPUT_MODE_JOYSTICK,   // C1350, or C1351 in joystick mode
+    INPUT_MODE_PADDLES,    // pair of C64 paddles, never detected
+    INPUT_MODE_TABLET,     // Koala Pad style touch tablet, never detected
+    INPUT_MODE_COUNT
+};
+
+/* What a joystick is reported as */
+enum {
+    JOYSTICK_OUTPUT_GAMEPAD = 0,
+    JOYSTICK_OUTPUT_MOUSE,  // mouse keys style movement
+    JOYSTICK_OUTPUT_COUNT
+};
+
+/* Indices into AdapterSettings.ButtonMap */
+enum {
+    BUTTON_INDEX_LEFT = 0,
+    BUTTON_INDEX_RIGHT,
+    BUTTON_INDEX_MIDDLE,  // left and right pressed together
+    BUTTON_INDEX_COUNT
+};
+
+/* Indices into AdapterSettings.KeyBindings */
+enum {
+    KEY_BINDING_MIDDLE = 0,  // middle button, instead of the mouse button
+    KEY_BINDING_FLICK_LEFT,  // flicks while holding the gesture buttons
+    KEY_BINDING_FLICK_RIGHT,
+    KEY_BINDING_FLICK_UP,
+    KEY_BINDING_FLICK_DOWN,
+    KEY_BINDING_COUNT
+};
+
+/* Keystroke sent by the keyboard interface. KeyCode 0 is unbound. */
+typedef struct {
+    uint8_t Modifier;  // HID keyboard modifier bitmask
+    uint8_t KeyCode;   // HID keyboard usage
+} __attribute__((packed)) KeyBinding;
+
+typedef struct {
+    /* Must be SETTINGS_VERSION */
+    uint8_t Version;
+    /* C1351 timer ticks per mouse count. Higher values lower the
+     * sensitivity. Default: F_CPU / 1 MHz, i.e. one count per microsecond.
+     */
+    uint8_t ScaleDivisor;
+    /* Smoothing filter strength. Each report moves the output by
+     * 1 / 2^FilterShift of the way towards the new velocity. 0 disables.
+     */
+    uint8_t FilterShift;
+    /* Discard single-sample movements larger than this many microseconds as
+     * glitches. 0 disables.
+     */
+    uint8_t SpikeLimit;
+    /* Number of C1351 read cycles (512 uS each, less with ReadPhaseMargin)
+     * per USB mouse report
+     */
+    uint8_t ReportInterval;
+    /* HID button bitmask sent for each mouse button (BUTTON_INDEX_*) */
+    uint8_t ButtonMap[BUTTON_INDEX_COUNT];
+    /* Calibration offsets subtracted from the POTX and POTY charge times
+     * of paddles and tablets, in capture timer ticks. C1351 movement is a
+     * difference of readings, which no offset changes.
+     */
+    int16_t PotOffsetX;
+    int16_t PotOffsetY;
+    /* Pointer acceleration curve, ACCEL_PROFILE_* */
+    uint8_t AccelProfile;
+    /* Type of mouse, INPUT_MODE_* */
+    uint8_t InputMode;
+    /* Joystick report, JOYSTICK_OUTPUT_* */
+    uint8_t JoystickOutput;
+    /* JOYSTICK_OUTPUT_MOUSE: the speed starts at 0 and increases by
+     * JoystickRamp / 16 counts per report with every report, up to
+     * JoystickMaxSpeed counts per report
+     */
+    uint8_t JoystickRamp;
+    uint8_t JoystickMaxSpeed;
+    /* Paddle charge time, in microseconds, that maps to the highest paddle
+     * value. Longer charge times are clamped.
+     */
+    uint16_t PaddleRange;
+    /* Each paddle report averages 2^PaddleAverageShift paddle readings */
+    uint8_t PaddleAverageShift;
+    /* Holding these buttons (bit BUTTON_INDEX_* per button) turns Y
+     * movement into wheel movement, see scroll.hpp. 0 disables.
+     */
+    uint8_t ScrollButtons;
+    /* Mouse counts per wheel detent */
+    uint8_t ScrollDivisor;
+    /* Left and right pressed within this many milliseconds of each other
+     * are the middle button, see middle_button.hpp. 0 disables.
+     */
+    uint8_t ChordWindow;
+    /* Flicking the mouse while holding these buttons (bit BUTTON_INDEX_* per
+     * button) sends the KEY_BINDING_FLICK_* keystrokes, see gesture.hpp.
+     * 0 disables.
+     */
+    uint8_t GestureButtons;
+    /* Keystrokes sent for each KEY_BINDING_*. Only used by firmware built
+     * with ENABLE_KEYBOARD.
+     */
+    KeyBinding KeyBindings[KEY_BINDING_COUNT];
+    /* End the C1351 read phase this many microseconds after the latest POT
+     * edge of recent read cycles, see read_phase.hpp. 0 keeps the full
+     * 256 uS read phase. Shorter read cycles also shorten the times counted
+     * in read cycles, like ReportInterval.
+     */
+    uint8_t ReadPhaseMargin;
+} __attribute__((packed)) AdapterSettings;
+
+
+#ifndef __cplusplus
+_Static_assert(sizeof(AdapterSettings) <= SETTINGS_REPORT_SIZE,
+               "AdapterSettings must fit in the settings feature report");
+#else
+static_assert(sizeof(AdapterSettings) <= SETTINGS_REPORT_SIZE,
+              "AdapterSettings must fit in the settings feature report");
+#endif
+
+
+/* Current settings. Only written by resetSettings() and applySettings(). */
+extern AdapterSettings adapter_settings;
+
+/* Restore the compiled-in default settings */
+void resetSettings(void);
+/* Validate and apply new settings. Returns false, leaving the current
+ * settings unchanged, if any field is out of range.
+ */
+bool applySettings(const AdapterSettings* settings);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
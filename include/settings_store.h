@@ -0,0 +1,45 @@
+/*  EEPROM storage of the adapter settings.
+
+    The settings are stored as CRC-protected records in a ring of EEPROM
+    slots. Each commit writes the next slot with an incremented sequence
+    number, which spreads the wear over the whole EEPROM. At startup, the
+    valid record with the newest sequence number is loaded.
+
+    EEPROM is only accessed from loadSettings() and handleSettingsCommand(),
+    never from the sampling interrupt.
+*/
+
+#pragma once
+#ifndef SETTINGS_STORE_H
+#define SETTINGS_STORE_H
+
+#include <stdint.h>
+
+#include "settings.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/* Load the most recently committed settings, or the defaults if there are
+ * none. Call once at startup, before interrupts are enabled.
+ */
+void loadSettings(void);
+/* Queue a SETTINGS_COMMAND_* from the host. Commands that access EEPROM are
+ * run later by handleSettingsCommand(); a new command replaces one that has
+ * not started yet.
+ */
+void requestSettingsCommand(uint8_t command);
+/* Returns the queued or running command, or SETTINGS_COMMAND_NONE */
+uint8_t getSettingsCommandStatus(void);
+/* Call from the main loop. Runs a queued commit or load. */
+void handleSettingsCommand(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,69 @@
+/*  Adapter status.
+
+    Measurements the host can read through the vendor-defined status feature
+    report (REPORT_ID_Status in descriptors.h), for tuning the settings.
+
+    Like settings.h, this header is the wire format of the report, is also
+    used by the host tools and must not depend on AVR or LUFA headers.
+    Multi-byte fields are little-endian.
+*/
+
+#pragma once
+#ifndef STATUS_H
+#define STATUS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/* Size in bytes of the status feature report, excluding the report ID.
+ * AdapterStatus is zero-padded to this size.
+ */
+#define STATUS_REPORT_SIZE 16
+
+typedef struct {
+    /* Length of the C1351 sync phase, in microseconds */
+    uint16_t SyncPhaseUs;
+    /* Length of the current C1351 read phase, in microseconds, see
+     * read_phase.hpp
+     */
+    uint16_t ReadPhaseUs;
+    /* Latest POT edge after the sync phase in the last tuning window, in
+     * microseconds
+     */
+    uint16_t LatestEdgeUs;
+    /* Shortest read phase that ran for a whole tuning window without a
+     * missing edge, in microseconds. 0 until one has.
+     */
+    uint16_t StableReadPhaseUs;
+    /* Read cycles that missed an edge because the read phase was shortened */
+    uint16_t MissedEdges;
+    /* Invalid quadrature transitions (missed edges) of an Amiga or Atari ST
+     * mouse since decoding started
+     */
+    uint16_t QuadratureErrors;
+} __attribute__((packed)) AdapterStatus;
+
+
+#ifndef __cplusplus
+_Static_assert(sizeof(AdapterStatus) <= STATUS_REPORT_SIZE,
+               "AdapterStatus must fit in the status feature report");
+#else
+static_assert(sizeof(AdapterStatus) <= STATUS_REPORT_SIZE,
+              "AdapterStatus must fit in the status feature report");
+#endif
+
+
+/* Current status */
+void getAdapterStatus(AdapterStatus* status);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
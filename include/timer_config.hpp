@@ -0,0 +1,85 @@
+/*  Compile-time timer configuration.
+
+    All values are computed by the compiler from F_CPU and the desired
+    intervals, and checked with static_assert, so retargeting to a different
+    clock or sample period fails to build instead of silently producing
+    wrong timing.
+*/
+
+#pragma once
+#ifndef TIMER_CONFIG_HPP
+#define TIMER_CONFIG_HPP
+
+#include <stdint.h>
+
+
+namespace c1351_mouse {
+
+/* Number of timer ticks in the given time, rounded to the nearest tick */
+constexpr uint32_t usToTicks(uint32_t cpu_hz, uint32_t prescale, uint32_t us)
+{
+    return ((uint64_t)cpu_hz * us + 500000ULL * prescale) / (1000000ULL * prescale);
+}
+
+
+/* Returns true if the given time is a whole number of timer ticks */
+constexpr bool usIsWholeTicks(uint32_t cpu_hz, uint32_t prescale, uint32_t us)
+{
+    return (uint64_t)cpu_hz * us % (1000000ULL * prescale) == 0;
+}
+
+
+/* Error of a tick count relative to the given time, in parts per million */
+constexpr uint32_t tickErrorPpm(uint32_t cpu_hz, uint32_t prescale, uint32_t us,
+                                uint32_t ticks)
+{
+    return ((uint64_t)ticks * prescale * 1000000ULL > (uint64_t)cpu_hz * us ?
+            (uint64_t)ticks * prescale * 1000000ULL - (uint64_t)cpu_hz * us :
+            (uint64_t)cpu_hz * us - (uint64_t)ticks * prescale * 1000000ULL) *
+           1000000ULL / ((uint64_t)cpu_hz * us);
+}
+
+
+/*  Timer 4 configuration for a periodic interrupt every IntervalUs.
+
+    Picks the smallest prescaler (highest resolution) for which the interval
+    fits the 8-bit counter. Timer 4 counts from 0 to TOP and then restarts,
+    so TOP must be written to OCR4C, and the compare match interrupt fires
+    once per period when OCR4A is set to any value up to TOP.
+*/
+template<uint32_t CpuHz, uint32_t IntervalUs, uint32_t MaxErrorPpm = 1000>
+struct Timer4Config {
+    static constexpr uint16_t MAX_TICKS = 256;
+    static constexpr uint8_t MAX_CLOCK_SELECT = 15;
+
+    /* Prescaler for a CS43:0 clock select value (0 stops the timer) */
+    static constexpr uint16_t prescaleFor(uint8_t clock_select)
+    {
+        return clock_select ? (uint16_t)1 << (clock_select - 1) : 0;
+    }
+
+    static constexpr uint8_t chooseClockSelect()
+    {
+        for (uint8_t cs = 1; cs <= MAX_CLOCK_SELECT; cs++) {
+            if (usToTicks(CpuHz, prescaleFor(cs), IntervalUs) <= MAX_TICKS) {
+                return cs;
+            }
+        }
+        return 0;
+    }
+
+    /* Value for the CS43:0 bits of TCCR4B */
+    static constexpr uint8_t CLOCK_SELECT = chooseClockSelect();
+    static constexpr uint16_t PRESCALE = prescaleFor(CLOCK_SELECT);
+    static constexpr uint32_t TICKS = usToTicks(CpuHz, PRESCALE, IntervalUs);
+    /* Value for OCR4C (and OCR4A) */
+    static constexpr uint8_t TOP = TICKS - 1;
+    static constexpr uint32_t ERROR_PPM = tickErrorPpm(CpuHz, PRESCALE, IntervalUs, TICKS);
+
+    static_assert(CLOCK_SELECT != 0, "interval too long for timer 4");
+    static_assert(TICKS >= 2, "interval too short for timer 4");
+    static_assert(ERROR_PPM <= MaxErrorPpm, "interval can't be generated accurately at this F_CPU");
+};
+
+}
+#endif
@@ -0,0 +1,25 @@
+#include "acceleration.hpp"
+
+
+namespace c1351_mouse {
+
+// constexpr ensures the tables are computed by the compiler
+constexpr AccelTable FLAT_TABLE = makeAccelTable(ACCEL_PROFILE_FLAT);
+constexpr AccelTable LINEAR_TABLE = makeAccelTable(ACCEL_PROFILE_LINEAR);
+constexpr AccelTable SIGMOID_TABLE = makeAccelTable(ACCEL_PROFILE_SIGMOID);
+
+static_assert(LINEAR_TABLE.gain[0] == ACCEL_GAIN_ONE &&
+              SIGMOID_TABLE.gain[0] == ACCEL_GAIN_ONE,
+              "acceleration must not change slow movements");
+static_assert(LINEAR_TABLE.gain[ACCEL_TABLE_SIZE - 1] == ACCEL_MAX_GAIN &&
+              SIGMOID_TABLE.gain[ACCEL_TABLE_SIZE - 1] == ACCEL_MAX_GAIN,
+              "acceleration curves must reach the maximum gain");
+
+// in ACCEL_PROFILE_* order
+const AccelTable accel_tables[ACCEL_PROFILE_COUNT] PROGMEM = {
+    FLAT_TABLE,
+    LINEAR_TABLE,
+    SIGMOID_TABLE,
+};
+
+}
@@ -0,0 +1,35 @@
+/*  Status LED of the selected board, see include/Board/LEDs.h */
+
+#include "board.hpp"
+#include "Board/LEDs.h"
+
+
+using namespace c1351_mouse;
+
+
+static uint8_t led_mask = LEDS_NO_LEDS;
+
+
+void LEDs_Init(void)
+{
+    Board::StatusLed::init();
+}
+
+
+void LEDs_Disable(void)
+{
+    Board::StatusLed::set(false);
+}
+
+
+void LEDs_SetAllLEDs(const uint8_t LEDMask)
+{
+    led_mask = LEDMask;
+    Board::StatusLed::set(LEDMask & LEDS_LED4);
+}
+
+
+uint8_t LEDs_GetLEDs(void)
+{
+    return led_mask;
+}
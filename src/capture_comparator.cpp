@@ -0,0 +1,177 @@
+/*  Input capture through the analog comparator, for boards without ICP3
+    (CAPTURE_BACKEND_COMPARATOR)
+
+    Timer 1 can capture the analog comparator output instead of ICP1
+    (ACIC). The comparator compares the 1.1 V bandgap reference with an ADC
+    pin chosen by the ADC multiplexer (ACME), so POTX and POTY can be on any
+    ADC pins. When a pot line charges past 1.1 V, the comparator output
+    falls, and timer 1 captures the edge in hardware like an ICP edge.
+    Timestamps keep the resolution of one timer tick. The comparator adds a
+    constant delay of less than 1 uS, which cancels out of the C1351
+    movement and is within the paddle calibration.
+
+    There is one comparator and one capture unit, so each read cycle
+    measures one axis, alternating between POTX and POTY. Each axis is
+    sampled every other read cycle, every 1024 uS (977 Hz) instead of every
+    512 uS. The axis not measured keeps the timestamp of its last
+    measurement.
+*/
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <stdint.h>
+
+#include "board.hpp"
+#include "capture_timer.hpp"
+
+#ifdef CAPTURE_BACKEND_COMPARATOR
+
+
+namespace c1351_mouse {
+
+const uint8_t NO_ADC_CHANNEL = 0xff;
+
+/* ADC multiplexer channel of pin P, NO_ADC_CHANNEL if it has none */
+template<typename P>
+constexpr uint8_t adcChannel()
+{
+    return isPin<P, PortF, 0>() ? 0 :
+           isPin<P, PortF, 1>() ? 1 :
+           isPin<P, PortF, 4>() ? 4 :
+           isPin<P, PortF, 5>() ? 5 :
+           isPin<P, PortF, 6>() ? 6 :
+           isPin<P, PortF, 7>() ? 7 :
+           isPin<P, PortD, 4>() ? 8 :
+           isPin<P, PortD, 6>() ? 9 :
+           isPin<P, PortD, 7>() ? 10 :
+           isPin<P, PortB, 4>() ? 11 :
+           isPin<P, PortB, 5>() ? 12 :
+           isPin<P, PortB, 6>() ? 13 : NO_ADC_CHANNEL;
+}
+
+
+constexpr uint8_t adcChannel(TimerNumber n)
+{
+    return n == Board::POTX_TIMER ? adcChannel<Board::Btn2PotX>() :
+           adcChannel<Board::PotY>();
+}
+
+static_assert(adcChannel(TIMER_1) != NO_ADC_CHANNEL &&
+              adcChannel(TIMER_3) != NO_ADC_CHANNEL,
+              "POTX and POTY must be on ADC pins");
+
+
+// capture state of each channel, indexed by TimerNumber
+static volatile uint16_t timestamps[2];
+// armed, waiting for the edge
+static volatile bool running[2];
+// the last measurement timed out without an edge
+static volatile bool missed[2];
+// channel measured in the current read cycle
+static volatile TimerNumber activeChannel = TIMER_3;
+
+
+ISR(TIMER1_CAPT_vect)
+{
+    // input capture flag is automatically cleared when this interrupt
+    // is executed
+
+    TCCR1B = 0;
+    TIMSK1 &= ~_BV(ICIE1);
+
+    timestamps[activeChannel] = ICR1;
+    running[activeChannel] = false;
+    missed[activeChannel] = false;
+}
+
+
+uint16_t getInputCaptureTimestamp(TimerNumber n)
+{
+    return timestamps[n];
+}
+
+
+/* Connect the negative comparator input to an ADC pin */
+void selectComparatorInput(uint8_t channel)
+{
+    if (channel & 8) {
+        ADCSRB |= _BV(MUX5);
+    }
+    else {
+        ADCSRB &= ~_BV(MUX5);
+    }
+    ADMUX = (ADMUX & ~(_BV(MUX2) | _BV(MUX1) | _BV(MUX0))) | (channel & 7);
+}
+
+
+void initInputCapture()
+{
+    TCCR1A = 0;
+    TCCR1B = 0;
+
+    // the multiplexer drives the comparator only while the ADC is off
+    ADCSRA &= ~_BV(ADEN);
+    ADCSRB |= _BV(ACME);
+    // bandgap on the positive input, output to timer 1 input capture
+    ACSR = _BV(ACBG) | _BV(ACIC);
+
+    // PF4-PF7 are JTAG pins unless JTAG is off, which takes two writes
+    // within four cycles
+    MCUCR |= _BV(JTD);
+    MCUCR |= _BV(JTD);
+
+    // both channels need a measurement before they are valid
+    for (uint8_t n = 0; n < 2; n++) {
+        running[n] = false;
+        missed[n] = true;
+    }
+
+    // clear input capture flag
+    TIFR1 |= _BV(ICF1);
+}
+
+
+void armInputCapture()
+{
+    TCCR1B = 0;
+
+    activeChannel = activeChannel == TIMER_1 ? TIMER_3 : TIMER_1;
+    selectComparatorInput(adcChannel(activeChannel));
+    running[activeChannel] = true;
+
+    static_assert(CAPTURE_TIMER_PRESCALE == 1, "only prescale x1 supported");
+    TCNT1 = 0;
+    // switching the multiplexer may have set the flag
+    TIFR1 |= _BV(ICF1);
+    TIMSK1 |= _BV(ICIE1);
+    // input capture on falling edge of the comparator output, no
+    // prescaling, noise cancellation
+    TCCR1B = _BV(ICNC1) | _BV(CS10);
+}
+
+
+void disarmInputCapture(TimerNumber n)
+{
+    if (running[n]) {
+        TCCR1B = 0;
+        TIMSK1 &= ~_BV(ICIE1);
+        running[n] = false;
+        missed[n] = true;
+    }
+}
+
+
+bool captureDelayed(TimerNumber)
+{
+    return false;
+}
+
+
+bool timerRunning(TimerNumber n)
+{
+    return running[n] || missed[n];
+}
+
+
+}
+#endif
@@ -0,0 +1,243 @@
+/*  Software input capture with external interrupts, for boards without
+    usable capture pins (CAPTURE_BACKEND_PIN_CHANGE)
+
+    POTX and POTY are on external interrupt pins (INT2, INT3 or INT6) set
+    to trigger on rising edges. The interrupt reads timer 1, which runs
+    freely from armInputCapture(), so timestamps have the same time base as
+    the ICP backend. Both axes are measured in every read cycle.
+
+    The timer is read a fixed number of cycles after the edge, the entry
+    latency of the interrupt, which is measured at startup with edges
+    driven by the adapter itself and subtracted from each timestamp.
+
+    An edge that arrives while another interrupt runs waits for it, by up
+    to the length of that interrupt. Interrupts that can run during a read
+    cycle report themselves through capture_blocker.h: when they end, an
+    edge interrupt that is already pending has waited, and its sample is
+    flagged (see captureDelayed()), so that the controllers skip it. The
+    edge interrupts check the other axis the same way, for an edge that
+    waits behind the edge of the first. Only the rest of the blocking
+    interrupt after captureBlockerEnd() or the check, its epilogue or the
+    remaining USB event checks, can delay an edge unnoticed.
+*/
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <stdint.h>
+
+#include "board.hpp"
+#include "capture_blocker.h"
+#include "capture_timer.hpp"
+
+#ifdef CAPTURE_BACKEND_PIN_CHANGE
+
+
+namespace c1351_mouse {
+
+const uint8_t NO_INTERRUPT = 0xff;
+
+/* Entry latency until it is measured, from the generated code */
+const uint8_t DEFAULT_ENTRY_LATENCY = 40;
+const uint8_t CALIBRATION_EDGES = 8;
+
+
+/* External interrupt of pin P, NO_INTERRUPT if it has none. INT0 and INT1
+ * are used by the buttons and the quadrature decoder.
+ */
+template<typename P>
+constexpr uint8_t externalInterrupt()
+{
+    return isPin<P, PortD, 2>() ? 2 :
+           isPin<P, PortD, 3>() ? 3 :
+           isPin<P, PortE, 6>() ? 6 : NO_INTERRUPT;
+}
+
+
+constexpr uint8_t externalInterrupt(TimerNumber n)
+{
+    return n == Board::POTX_TIMER ? externalInterrupt<Board::Btn2PotX>() :
+           externalInterrupt<Board::PotY>();
+}
+
+static_assert(externalInterrupt(TIMER_1) != NO_INTERRUPT &&
+              externalInterrupt(TIMER_3) != NO_INTERRUPT,
+              "POTX and POTY must be on INT2, INT3 or INT6");
+
+
+// capture state of each channel, indexed by TimerNumber
+static volatile uint16_t timestamps[2];
+// armed, waiting for the edge
+static volatile bool running[2];
+// the edge may have waited for another interrupt
+static volatile bool delayed[2];
+// timer ticks from the edge to the timer read in the interrupt
+static uint8_t entryLatency[2] = {DEFAULT_ENTRY_LATENCY, DEFAULT_ENTRY_LATENCY};
+
+
+static inline void captureEdge(uint8_t interrupt, uint16_t now)
+{
+    const TimerNumber n = externalInterrupt(TIMER_1) == interrupt ? TIMER_1 : TIMER_3;
+    const TimerNumber other = n == TIMER_1 ? TIMER_3 : TIMER_1;
+
+    EIMSK &= ~_BV(interrupt);
+
+    timestamps[n] = now - entryLatency[n];
+    running[n] = false;
+
+    // an edge of the other channel since the entry has to wait for this
+    // interrupt
+    if (running[other] && (EIFR & _BV(externalInterrupt(other)))) {
+        delayed[other] = true;
+    }
+}
+
+
+// the external interrupt flag is automatically cleared when these
+// interrupts are executed
+
+ISR(INT2_vect)
+{
+    captureEdge(2, TCNT1);
+}
+
+
+ISR(INT3_vect)
+{
+    captureEdge(3, TCNT1);
+}
+
+
+ISR(INT6_vect)
+{
+    captureEdge(6, TCNT1);
+}
+
+
+extern "C" void captureBlockerEnd(void)
+{
+    // interrupts are disabled, an edge since the entry of the calling
+    // interrupt left its flag set
+    for (uint8_t n = TIMER_1; n <= TIMER_3; n++) {
+        if (running[n] && (EIFR & _BV(externalInterrupt((TimerNumber)n)))) {
+            delayed[n] = true;
+        }
+    }
+}
+
+
+uint16_t getInputCaptureTimestamp(TimerNumber n)
+{
+    return timestamps[n];
+}
+
+
+bool captureDelayed(TimerNumber n)
+{
+    return delayed[n];
+}
+
+
+/* Enable the interrupt of a channel on the next rising edge */
+static void armChannel(TimerNumber n)
+{
+    const uint8_t interrupt = externalInterrupt(n);
+
+    running[n] = true;
+    delayed[n] = false;
+    EIFR = _BV(interrupt);
+    EIMSK |= _BV(interrupt);
+}
+
+
+/* Measure the entry latency of a channel. External interrupts also trigger
+ * on output pins, so the adapter drives the edges itself, and keeps the
+ * shortest of CALIBRATION_EDGES in case another interrupt ran. Leaves the
+ * pin low.
+ */
+template<typename P>
+static void measureEntryLatency(TimerNumber n)
+{
+    uint8_t shortest = 0xff;
+
+    entryLatency[n] = 0;
+    P::low();
+    P::setDirectionOut();
+
+    for (uint8_t i = 0; i < CALIBRATION_EDGES; i++) {
+        P::low();
+        armChannel(n);
+
+        uint16_t start = TCNT1;
+        P::high();
+        for (uint8_t wait = 0xff; running[n] && wait; wait--) {
+        }
+
+        uint16_t latency = timestamps[n] - start;
+        if (!running[n] && latency < shortest) {
+            shortest = latency;
+        }
+    }
+
+    disarmInputCapture(n);
+    P::low();
+    entryLatency[n] = shortest != 0xff ? shortest : DEFAULT_ENTRY_LATENCY;
+}
+
+
+void initInputCapture()
+{
+    static bool calibrated = false;
+
+    static_assert(CAPTURE_TIMER_PRESCALE == 1, "only prescale x1 supported");
+    TCCR1A = 0;
+    // Timer 1, no prescaling, no interrupts
+    TCCR1B = _BV(CS10);
+
+    // rising edges
+    for (uint8_t n = TIMER_1; n <= TIMER_3; n++) {
+        const uint8_t interrupt = externalInterrupt((TimerNumber)n);
+
+        EIMSK &= ~_BV(interrupt);
+        if (interrupt < 4) {
+            EICRA |= 3 << (2 * interrupt);
+        }
+        else {
+            EICRB |= 3 << (2 * (interrupt - 4));
+        }
+        running[n] = false;
+    }
+
+    // Calibrate once, from the main program. When called from an interrupt,
+    // the edges would not be taken.
+    if (!calibrated && (SREG & _BV(SREG_I))) {
+        measureEntryLatency<Board::Btn2PotX>(Board::POTX_TIMER);
+        measureEntryLatency<Board::PotY>(Board::POTY_TIMER);
+        calibrated = true;
+    }
+}
+
+
+void armInputCapture()
+{
+    TCNT1 = 0;
+
+    armChannel(TIMER_1);
+    armChannel(TIMER_3);
+}
+
+
+void disarmInputCapture(TimerNumber n)
+{
+    EIMSK &= ~_BV(externalInterrupt(n));
+    running[n] = false;
+}
+
+
+bool timerRunning(TimerNumber n)
+{
+    return running[n];
+}
+
+
+}
+#endif
@@ -10,25 +10,70 @@
     Capture is disarmed automatically after each successful capture.
     To disarm manually, call disarmInputCapture()
 
+    With CAPTURE_POLLED, no capture or overflow interrupts are used. The
+    capture unit latches the edge in ICRn and sets ICFn by itself, and the
+    registers are read when the read cycle ends, in disarmInputCapture(),
+    or when a timestamp is requested. The timers run until the next
+    armInputCapture(). ICRn then holds the last rising edge of the cycle
+    instead of the first, which is the same edge, as the POT lines rise
+    only once per cycle.
+
 */
 
 #include <avr/interrupt.h>
 #include <avr/io.h>
 #include <stdint.h>
 
+#include "board.hpp"
 #include "capture_timer.hpp"
 
+#ifdef CAPTURE_BACKEND_ICP
+
 
 namespace c1351_mouse {
 
+/* Returns true if pin P is the input capture pin of the timer */
+template<typename P>
+constexpr bool isCapturePin(TimerNumber timer)
+{
+    return timer == TIMER_1 ? isPin<P, PortD, 4>() : isPin<P, PortC, 7>();
+}
+
+static_assert(isCapturePin<Board::Btn2PotX>(Board::POTX_TIMER) &&
+              isCapturePin<Board::PotY>(Board::POTY_TIMER),
+              "POTX and POTY must be on the input capture pins of their timers");
+
+
 volatile uint16_t overflowsTimer1 = 0;
 volatile uint16_t timestampTimer1 = 0;
 volatile uint16_t overflowsTimer3 = 0;
 volatile uint16_t timestampTimer3 = 0;
 
 
+#ifdef CAPTURE_POLLED
+/* Copy the captured timestamp of a timer, if it has one */
+void pollCapture(TimerNumber n)
+{
+    if (n == TIMER_1) {
+        if (TIFR1 & _BV(ICF1)) {
+            timestampTimer1 = ICR1;
+        }
+    }
+    else {
+        if (TIFR3 & _BV(ICF3)) {
+            timestampTimer3 = ICR3;
+        }
+    }
+}
+#endif
+
+
 uint16_t getInputCaptureTimestamp(TimerNumber n)
 {
+#ifdef CAPTURE_POLLED
+    pollCapture(n);
+#endif
+
     if (n == TIMER_1) {
         return timestampTimer1;
     }
@@ -38,6 +83,7 @@ uint16_t getInputCaptureTimestamp(TimerNumber n)
 }
 
 
+#ifndef CAPTURE_POLLED
 ISR(TIMER1_OVF_vect)
 {
     overflowsTimer1++;
@@ -70,6 +116,7 @@ ISR(TIMER3_CAPT_vect)
 
     timestampTimer3 = ICR3;
 }
+#endif
 
 
 void startTimer1()
@@ -135,7 +182,9 @@ void initInputCapture()
 void resetCapture1()
 {
     TCNT1 = 0;
+#ifndef CAPTURE_POLLED
     TIMSK1 |= _BV(ICIE1) | _BV(TOIE1);  // enable capture interrupt, overflow interrupt
+#endif
     TIFR1 |= _BV(ICF1);    // clear input capture flag
 }
 
@@ -143,7 +192,9 @@ void resetCapture1()
 void resetCapture3()
 {
     TCNT3 = 0;
+#ifndef CAPTURE_POLLED
     TIMSK3 |= _BV(ICIE3) | _BV(TOIE3);  // enable capture interrupt, overflow interrupt
+#endif
     TIFR3 |= _BV(ICF3);    // clear input capture flag
 }
 
@@ -163,6 +214,10 @@ void armInputCapture()
 
 void disarmInputCapture(TimerNumber n)
 {
+#ifdef CAPTURE_POLLED
+    pollCapture(n);
+#endif
+
     if (n == TIMER_1) {
         TIMSK1 &= ~_BV(ICIE1);  // disable capture interrupt
     }
@@ -174,8 +229,22 @@ void disarmInputCapture(TimerNumber n)
 }
 
 
+bool captureDelayed(TimerNumber)
+{
+    return false;
+}
+
+
 bool timerRunning(TimerNumber n)
 {
+#ifdef CAPTURE_POLLED
+    // running until the edge, like the timers stopped by the interrupts
+    if (n == TIMER_1) {
+        return (TCCR1B & (_BV(CS12) | _BV(CS11) | _BV(CS10))) && !(TIFR1 & _BV(ICF1));
+    } else {
+        return (TCCR3B & (_BV(CS32) | _BV(CS31) | _BV(CS30))) && !(TIFR3 & _BV(ICF3));
+    }
+#else
     if (n == TIMER_1) {
         return TCCR1B & (_BV(CS12) | _BV(CS11) | _BV(CS10));
         //return TIMSK1 & ~_BV(ICIE1);
@@ -183,7 +252,9 @@ bool timerRunning(TimerNumber n)
         return TCCR3B & (_BV(CS32) | _BV(CS31) | _BV(CS30));
         //return TIMSK3 & ~_BV(ICIE3);
     }
+#endif
 }
 
 
 }
+#endif
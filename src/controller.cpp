@@ -2,8 +2,12 @@
 #include <avr/io.h>
 #include <stdlib.h>
 
+#include "acceleration.hpp"
 #include "capture_timer.hpp"
 #include "controller.hpp"
+#include "quadrature.hpp"
+#include "settings.h"
+#include "timer_config.hpp"
 #ifdef ENABLE_VIRTUAL_SERIAL
     #include "mouse.h"
 #endif
@@ -15,10 +19,18 @@ const int CPU_TO_US_MULTIPLIER = F_CPU / 1000000;
 
 namespace c1351_mouse {
 
+// The POTX and POTY lines are held low for this long at the start of each
+// read cycle (the "sync" state of the C1351).
+const uint16_t POT_SYNC_US = 256;
+const uint16_t POT_SYNC_TICKS = usToTicks(F_CPU, CAPTURE_TIMER_PRESCALE, POT_SYNC_US);
+static_assert(usIsWholeTicks(F_CPU, CAPTURE_TIMER_PRESCALE, POT_SYNC_US),
+              "sync time must be a whole number of capture timer ticks");
+
+
 C1351Interface::C1351Interface() : potXValue(0), potYValue(0), potXValueOld(0),
     potYValueOld(0), velocityX(0), velocityY(0), velocityAccumX(0), velocityAccumY(0),
     buttonLeftPressed(false),
-    buttonRightPressed(false)
+    buttonRightPressed(false), filterStateX(0), filterStateY(0)
 {
 }
 
@@ -45,29 +57,54 @@ void C1351Interface::init()
 }
 
 
+void C1351Interface::stop()
+{
+    captureValid = cycleStarted && !timerRunning(Board::POTY_TIMER);
+    cycleStarted = false;
+    potValuesValid = false;
+
+    disarmInputCapture(Board::POTX_TIMER);
+    disarmInputCapture(Board::POTY_TIMER);
+    setPotsInput();
+}
+
+
 void C1351Interface::setModeSync()
 {
     //io_pin.debug.low();
 
-    bool last_capture_invalid = timerRunning(TIMER_3);
+    // If Timer 3 (POTY) is still running at the start of a sync, it means
+    // we didn't detect a positive edge during the last sync.
+    // This could happen if there is no mouse connected, or if the mouse is
+    // in "joystick"/"C1350" mode. POTX can only be late if the read phase
+    // is shortened (see read_phase.hpp).
+    captureValid = cycleStarted && !timerRunning(Board::POTY_TIMER) &&
+                   !timerRunning(Board::POTX_TIMER);
+    cycleStarted = true;
 
     // TODO: are these necessary?
-    disarmInputCapture(TIMER_1);
-    disarmInputCapture(TIMER_3);
+    disarmInputCapture(Board::POTX_TIMER);
+    disarmInputCapture(Board::POTY_TIMER);
 
     armInputCapture();
 
     setPotsOutputLow();
 
-    if (last_capture_invalid) {
-        // If Timer 3 (POTY) is still running at the start of a sync, it means
-        // we didn't detect a positive edge during the last sync.
-        // This could happen if there is no mouse connected, or if the mouse is
-        // in "joystick"/"C1350" mode.
+    if (!captureValid) {
+        potValuesValid = false;
+        return;
+    }
+    updateLatestEdge();
+    if (captureDelayed(Board::POTX_TIMER) || captureDelayed(Board::POTY_TIMER)) {
+        // keep the last values, the movement is taken from the next cycle
+        updateButtons();
         return;
     }
     updatePotValues();
-    accumulateVelocities();
+    if (potValuesValid) {
+        accumulateVelocities();
+    }
+    potValuesValid = true;
 
     updateButtons();
 }
@@ -80,20 +117,27 @@ void C1351Interface::setModeRead()
 }
 
 
+void C1351Interface::updateLatestEdge()
+{
+    uint16_t x = getInputCaptureTimestamp(Board::POTX_TIMER);
+    uint16_t y = getInputCaptureTimestamp(Board::POTY_TIMER);
+    uint16_t latest = x > y ? x : y;
+
+    latestEdgeUs = latest > POT_SYNC_TICKS ?
+                   (latest - POT_SYNC_TICKS) / CPU_TO_US_MULTIPLIER : 0;
+}
+
+
 /* Call to update pot values with most recent input capture timestamp. */
 void C1351Interface::updatePotValues()
 {
     // Subtract the first 256 uS from the captured timestamp -- this is the
     // amount of time the C1351 will be in "sync" state after its SYNC pin
     // is pulled low.
-    const uint16_t TIMESTAMP_ADJUST_US = 256;
-    const uint16_t TIMESTAMP_ADJUST = (F_CPU / 1000000.0) * TIMESTAMP_ADJUST_US /
-                                      CAPTURE_TIMER_PRESCALE;
-
     potXValueOld = potXValue;
     potYValueOld = potYValue;
-    potXValue = getInputCaptureTimestamp(TIMER_1) - TIMESTAMP_ADJUST;
-    potYValue = getInputCaptureTimestamp(TIMER_3) - TIMESTAMP_ADJUST;
+    potXValue = getInputCaptureTimestamp(Board::POTX_TIMER) - POT_SYNC_TICKS;
+    potYValue = getInputCaptureTimestamp(Board::POTY_TIMER) - POT_SYNC_TICKS;
 }
 
 
@@ -105,8 +149,20 @@ void C1351Interface::accumulateVelocities()
     auto new_x_velocity = potValueToVelocity(potXValueOld, potXValue);
     auto new_y_velocity = -potValueToVelocity(potYValueOld, potYValue);
 
-    velocityAccumX += new_x_velocity;
-    velocityAccumY += new_y_velocity;
+    if (adapter_settings.SpikeLimit) {
+        const int16_t limit = adapter_settings.SpikeLimit * CPU_TO_US_MULTIPLIER;
+        if (abs(new_x_velocity) > limit || abs(new_y_velocity) > limit) {
+            return;
+        }
+    }
+
+    uint16_t speed_x = abs(new_x_velocity);
+    uint16_t speed_y = abs(new_y_velocity);
+    uint8_t gain = getAccelGain(adapter_settings.AccelProfile,
+                                speed_x > speed_y ? speed_x : speed_y);
+
+    velocityAccumX += ((int32_t)new_x_velocity * gain) >> ACCEL_GAIN_SHIFT;
+    velocityAccumY += ((int32_t)new_y_velocity * gain) >> ACCEL_GAIN_SHIFT;
 }
 
 
@@ -123,8 +179,10 @@ void C1351Interface::updateButtons()
 */
 void C1351Interface::update()
 {
-    velocityX = velocityAccumX / CPU_TO_US_MULTIPLIER;
-    velocityY = velocityAccumY / CPU_TO_US_MULTIPLIER;
+    velocityX = applyFilter(filterStateX,
+                            clampVelocity(velocityAccumX / adapter_settings.ScaleDivisor));
+    velocityY = applyFilter(filterStateY,
+                            clampVelocity(velocityAccumY / adapter_settings.ScaleDivisor));
 #ifdef ENABLE_VIRTUAL_SERIAL
     serialPrintNum(velocityX);
 #endif
@@ -157,35 +215,511 @@ bool C1351Interface::getRightButtonValue() const
 }
 
 
-void C1351Interface::setPotsOutputLow()
+bool C1351Interface::isCaptureValid() const
 {
-    io_pin.poty.low();
-    io_pin.poty.setDirectionOut();
+    return captureValid;
+}
 
-    io_pin.btn2_potx.low();
-    io_pin.btn2_potx.setDirectionOut();
+
+uint16_t C1351Interface::getLatestEdgeUs() const
+{
+    return latestEdgeUs;
+}
+
+
+void C1351Interface::setPotsOutputLow()
+{
+    io_pin.pots.low();
+    io_pin.pots.setDirectionOut();
 }
 
 
 void C1351Interface::setPotsInput()
 {
-    io_pin.poty.setDirectionIn();
-    io_pin.btn2_potx.setDirectionIn();
+    io_pin.pots.setDirectionIn();
+}
+
+
+MouseVelocity C1351Interface::clampVelocity(int32_t velocity)
+{
+    const int32_t VELOCITY_MAX = 32767;
+
+    if (velocity > VELOCITY_MAX) {
+        return VELOCITY_MAX;
+    }
+    if (velocity < -VELOCITY_MAX) {
+        return -VELOCITY_MAX;
+    }
+    return velocity;
+}
+
+
+/*  Exponential smoothing filter, see AdapterSettings::FilterShift.
+    The state keeps 8 fractional bits so that slow movements are not lost
+    to rounding, and the output is rounded to the nearest count.
+*/
+MouseVelocity C1351Interface::applyFilter(int32_t& state, MouseVelocity velocity)
+{
+    const uint8_t shift = adapter_settings.FilterShift;
+
+    if (shift == 0) {
+        return velocity;
+    }
+
+    // a multiplication, a left shift of a negative value is undefined
+    int32_t target = (int32_t)velocity * 256;
+    state += (target - state) >> shift;
+    return (state + 128) >> 8;
 }
 
 
 int16_t C1351Interface::potValueToVelocity(PotValue oldVal, PotValue newVal)
 {
-    uint16_t diff = (newVal - oldVal) & 0x7ff;  // 2047
-    bool isPositive = diff < (1 << 10);  // 1024
+    // The C1351 reports positions modulo 64 steps of 2 uS each, so the
+    // difference wraps every 128 uS (2048 ticks at 16 MHz).
+    const uint16_t POT_WRAP = usToTicks(F_CPU, CAPTURE_TIMER_PRESCALE, 128);
+    static_assert(usIsWholeTicks(F_CPU, CAPTURE_TIMER_PRESCALE, 128) &&
+                  (POT_WRAP & (POT_WRAP - 1)) == 0,
+                  "C1351 position range must be a power of two capture timer ticks");
+
+    uint16_t diff = (newVal - oldVal) & (POT_WRAP - 1);
+    bool isPositive = diff < POT_WRAP / 2;
 
     if (isPositive) {  // diff is positive
         return (int16_t)diff;
     }
-    else {    // diff is negative
-        diff |= 0b1111100000000000;
+    else {    // diff is negative, sign extend
+        diff |= ~(POT_WRAP - 1);
         return (int16_t)diff;
     }
 }
 
+
+void QuadratureInterface::init(uint8_t input_mode)
+{
+    // POTY (DB9 pin 5) is unused
+    io_pin.btn1.setDirectionIn(true);
+    io_pin.btn2_potx.setDirectionIn(true);
+    io_pin.poty.setDirectionIn(true);
+
+    velocityX = 0;
+    velocityY = 0;
+    initQuadrature(input_mode);
+}
+
+
+void QuadratureInterface::stop()
+{
+    stopQuadrature();
+}
+
+
+void QuadratureInterface::update()
+{
+    int16_t x;
+    int16_t y;
+
+    takeQuadratureCounts(x, y);
+    velocityX = x;
+    velocityY = y;
+
+    buttonLeftPressed = !io_pin.btn1.read();
+    buttonRightPressed = !io_pin.btn2_potx.read();
+}
+
+
+MouseVelocity QuadratureInterface::getVelocityX() const
+{
+    return velocityX;
+}
+
+
+MouseVelocity QuadratureInterface::getVelocityY() const
+{
+    return velocityY;
+}
+
+
+bool QuadratureInterface::getLeftButtonValue() const
+{
+    return buttonLeftPressed;
+}
+
+
+bool QuadratureInterface::getRightButtonValue() const
+{
+    return buttonRightPressed;
+}
+
+
+// JoystickInterface::pressed bits
+enum {
+    JOYSTICK_UP = 1 << 0,
+    JOYSTICK_DOWN = 1 << 1,
+    JOYSTICK_LEFT = 1 << 2,
+    JOYSTICK_RIGHT = 1 << 3,
+    JOYSTICK_FIRE = 1 << 4,
+    JOYSTICK_BUTTON_2 = 1 << 5,
+};
+
+const uint8_t JOYSTICK_DIRECTIONS = JOYSTICK_UP | JOYSTICK_DOWN | JOYSTICK_LEFT |
+                                    JOYSTICK_RIGHT;
+
+
+void JoystickInterface::init()
+{
+    io_pin.up_btn2.setDirectionIn(true);
+    io_pin.down.setDirectionIn(true);
+    io_pin.left.setDirectionIn(true);
+    io_pin.right.setDirectionIn(true);
+    io_pin.btn1.setDirectionIn(true);
+    io_pin.btn2_potx.setDirectionIn(true);
+
+    pressed = 0;
+    candidate = 0;
+    debounceCount = 0;
+    speed = 0;
+    distance = 0;
+    velocityX = 0;
+    velocityY = 0;
+}
+
+
+uint8_t JoystickInterface::readInputs()
+{
+    // direction line bits match JOYSTICK_UP..JOYSTICK_RIGHT
+    uint8_t inputs = ~readDirectionLines() & DIRECTION_LINES_MASK;
+
+    if (!io_pin.btn1.read()) {
+        inputs |= JOYSTICK_FIRE;
+    }
+    if (!io_pin.btn2_potx.read()) {
+        inputs |= JOYSTICK_BUTTON_2;
+    }
+
+    return inputs;
+}
+
+
+void JoystickInterface::scan()
+{
+    uint8_t inputs = readInputs();
+
+    if (inputs != candidate) {
+        candidate = inputs;
+        debounceCount = 0;
+    }
+    else if (debounceCount < JOYSTICK_DEBOUNCE_CYCLES) {
+        if (++debounceCount == JOYSTICK_DEBOUNCE_CYCLES) {
+            pressed = candidate;
+        }
+    }
+}
+
+
+void JoystickInterface::update()
+{
+    if (!(pressed & JOYSTICK_DIRECTIONS)) {
+        speed = 0;
+        distance = 0;
+        velocityX = 0;
+        velocityY = 0;
+        return;
+    }
+
+    const uint16_t max_speed = (uint16_t)adapter_settings.JoystickMaxSpeed << 4;
+
+    speed += adapter_settings.JoystickRamp;
+    if (speed > max_speed) {
+        speed = max_speed;
+    }
+
+    uint16_t position = distance + speed;
+    MouseVelocity step = position >> 4;
+    distance = position & 0x0f;
+
+    velocityX = getDirectionX() * step;
+    velocityY = getDirectionY() * step;
+}
+
+
+int8_t JoystickInterface::getDirectionX() const
+{
+    return (pressed & JOYSTICK_RIGHT ? 1 : 0) - (pressed & JOYSTICK_LEFT ? 1 : 0);
+}
+
+
+int8_t JoystickInterface::getDirectionY() const
+{
+    return (pressed & JOYSTICK_DOWN ? 1 : 0) - (pressed & JOYSTICK_UP ? 1 : 0);
+}
+
+
+MouseVelocity JoystickInterface::getVelocityX() const
+{
+    return velocityX;
+}
+
+
+MouseVelocity JoystickInterface::getVelocityY() const
+{
+    return velocityY;
+}
+
+
+bool JoystickInterface::getLeftButtonValue() const
+{
+    return pressed & JOYSTICK_FIRE;
+}
+
+
+bool JoystickInterface::getRightButtonValue() const
+{
+    return pressed & JOYSTICK_BUTTON_2;
+}
+
+
+void PaddleInterface::init()
+{
+    // fire buttons
+    io_pin.left.setDirectionIn(true);
+    io_pin.right.setDirectionIn(true);
+
+    cycleStarted = false;
+    sumX = 0;
+    sumY = 0;
+    sampleCount = 0;
+    blockInRange = true;
+    inRange = false;
+
+    initInputCapture();
+    io_pin.pots.low();
+    io_pin.pots.setDirectionOut();
+}
+
+
+void PaddleInterface::stop()
+{
+    cycleStarted = false;
+
+    disarmInputCapture(Board::POTX_TIMER);
+    disarmInputCapture(Board::POTY_TIMER);
+    io_pin.pots.setDirectionIn();
+}
+
+
+/* Charge time of the last read cycle, less the calibration offset of the
+ * axis, from 0 to the paddle range. A timer that is still running did not
+ * see the line reach the input threshold within the read cycle.
+ */
+uint16_t PaddleInterface::readChargeTime(TimerNumber n, uint16_t range)
+{
+    if (timerRunning(n)) {
+        blockInRange = false;
+        return range;
+    }
+
+    const int16_t offset = n == Board::POTX_TIMER ? adapter_settings.PotOffsetX :
+                           adapter_settings.PotOffsetY;
+    int16_t charge = getInputCaptureTimestamp(n) - POT_SYNC_TICKS - offset;
+
+    if (charge < 0) {
+        return 0;
+    }
+    if ((uint16_t)charge >= range) {
+        blockInRange = false;
+        return range;
+    }
+    return charge;
+}
+
+
+void PaddleInterface::setModeSync()
+{
+    if (cycleStarted && !captureDelayed(Board::POTX_TIMER) &&
+            !captureDelayed(Board::POTY_TIMER)) {
+        const uint16_t range = adapter_settings.PaddleRange * CPU_TO_US_MULTIPLIER;
+        const uint8_t shift = adapter_settings.PaddleAverageShift;
+
+        sumX += readChargeTime(Board::POTX_TIMER, range);
+        sumY += readChargeTime(Board::POTY_TIMER, range);
+
+        if (++sampleCount >= (1 << shift)) {
+            chargeX = sumX >> shift;
+            chargeY = sumY >> shift;
+            inRange = blockInRange;
+            sumX = 0;
+            sumY = 0;
+            sampleCount = 0;
+            blockInRange = true;
+        }
+    }
+    cycleStarted = true;
+
+    disarmInputCapture(Board::POTX_TIMER);
+    disarmInputCapture(Board::POTY_TIMER);
+
+    armInputCapture();
+
+    io_pin.pots.low();
+    io_pin.pots.setDirectionOut();
+}
+
+
+void PaddleInterface::setModeRead()
+{
+    io_pin.pots.setDirectionIn();
+}
+
+
+void PaddleInterface::update()
+{
+    const uint16_t range = adapter_settings.PaddleRange * CPU_TO_US_MULTIPLIER;
+
+    valueX = (uint32_t)chargeX * PADDLE_VALUE_MAX / range;
+    valueY = (uint32_t)chargeY * PADDLE_VALUE_MAX / range;
+
+    fireXPressed = !io_pin.left.read();
+    fireYPressed = !io_pin.right.read();
+}
+
+
+uint16_t PaddleInterface::getValueX() const
+{
+    return valueX;
+}
+
+
+uint16_t PaddleInterface::getValueY() const
+{
+    return valueY;
+}
+
+
+uint16_t PaddleInterface::getChargeX() const
+{
+    return chargeX;
+}
+
+
+uint16_t PaddleInterface::getChargeY() const
+{
+    return chargeY;
+}
+
+
+bool PaddleInterface::isInRange() const
+{
+    return inRange;
+}
+
+
+bool PaddleInterface::getFireXValue() const
+{
+    return fireXPressed;
+}
+
+
+bool PaddleInterface::getFireYValue() const
+{
+    return fireYPressed;
+}
+
+
+void TabletInterface::init()
+{
+    minX = 0xffff;
+    maxX = 0;
+    minY = 0xffff;
+    maxY = 0;
+    wasInRange = false;
+}
+
+
+/* Map a charge time onto 0 - TABLET_POSITION_MAX, using the learned range */
+uint16_t TabletInterface::scale(uint16_t charge, uint16_t min, uint16_t max)
+{
+    if (max < min + TABLET_MIN_SPAN) {
+        return TABLET_POSITION_MAX / 2;
+    }
+
+    return (uint32_t)(charge - min) * TABLET_POSITION_MAX / (max - min);
+}
+
+
+/*  Same exponential smoothing as C1351Interface::applyFilter(), on
+    absolute positions
+*/
+uint16_t TabletInterface::smooth(uint32_t& state, uint16_t position)
+{
+    const uint8_t shift = adapter_settings.FilterShift;
+    uint32_t target = (uint32_t)position << 8;
+
+    if (shift == 0 || !wasInRange) {
+        // pen down: jump to the position
+        state = target;
+    }
+    else {
+        state = state + ((int32_t)(target - state) >> shift);
+    }
+
+    return (state + 128) >> 8;
+}
+
+
+void TabletInterface::update(const PaddleInterface& paddles)
+{
+    buttonLeftPressed = paddles.getFireXValue();
+    buttonRightPressed = paddles.getFireYValue();
+
+    if (!paddles.isInRange()) {
+        wasInRange = false;
+        return;
+    }
+
+    uint16_t charge_x = paddles.getChargeX();
+    uint16_t charge_y = paddles.getChargeY();
+
+    if (charge_x < minX) {
+        minX = charge_x;
+    }
+    if (charge_x > maxX) {
+        maxX = charge_x;
+    }
+    if (charge_y < minY) {
+        minY = charge_y;
+    }
+    if (charge_y > maxY) {
+        maxY = charge_y;
+    }
+
+    positionX = smooth(filterStateX, scale(charge_x, minX, maxX));
+    positionY = smooth(filterStateY, scale(charge_y, minY, maxY));
+    wasInRange = true;
+}
+
+
+uint16_t TabletInterface::getPositionX() const
+{
+    return positionX;
+}
+
+
+uint16_t TabletInterface::getPositionY() const
+{
+    return positionY;
+}
+
+
+bool TabletInterface::getLeftButtonValue() const
+{
+    return buttonLeftPressed;
+}
+
+
+bool TabletInterface::getRightButtonValue() const
+{
+    return buttonRightPressed;
+}
+
 }
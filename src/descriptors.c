@@ -37,6 +37,8 @@
 
 
 #include "descriptors.h"
+#include "settings.h"
+#include "status.h"
 
 /** HID class report descriptor. This is a special descriptor constructed with values from the
     USBIF HID class specification to describe the reports and capabilities of the HID device. This
@@ -45,17 +47,150 @@
     more details on HID report descriptors.
 */
 const USB_Descriptor_HIDReport_Datatype_t PROGMEM MouseReport[] = {
-    /*  Use the HID class driver's standard Mouse report.
-         Min logical X/Y Axis values
-         Max logical X/Y Axis values
-         Min physical X/Y Axis values (used to determine resolution)
-         Max physical X/Y Axis values (used to determine resolution)
-         Buttons
-         Absolute screen coordinates: false
+    /*  Same as the HID class driver's standard Mouse report
+        (HID_DESCRIPTOR_MOUSE with AbsoluteCoords=false), with a report ID
+        and a wheel. The wheel and its resolution multiplier share a logical
+        collection, which tells the host that the multiplier applies to it.
     */
-    HID_DESCRIPTOR_MOUSE(AXIS_MIN, AXIS_MAX, AXIS_MIN, AXIS_MAX, BUTTONS, false)
+    HID_RI_USAGE_PAGE(8, 0x01),            /* Generic Desktop */
+    HID_RI_USAGE(8, 0x02),                 /* Mouse */
+    HID_RI_COLLECTION(8, 0x01),            /* Application */
+        HID_RI_REPORT_ID(8, REPORT_ID_Mouse),
+        HID_RI_USAGE(8, 0x01),             /* Pointer */
+        HID_RI_COLLECTION(8, 0x00),        /* Physical */
+            HID_RI_USAGE_PAGE(8, 0x09),    /* Button */
+            HID_RI_USAGE_MINIMUM(8, 0x01),
+            HID_RI_USAGE_MAXIMUM(8, BUTTONS),
+            HID_RI_LOGICAL_MINIMUM(8, 0x00),
+            HID_RI_LOGICAL_MAXIMUM(8, 0x01),
+            HID_RI_REPORT_COUNT(8, BUTTONS),
+            HID_RI_REPORT_SIZE(8, 0x01),
+            HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+            HID_RI_REPORT_COUNT(8, 0x01),
+            HID_RI_REPORT_SIZE(8, (BUTTONS % 8) ? (8 - (BUTTONS % 8)) : 0),
+            HID_RI_INPUT(8, HID_IOF_CONSTANT),
+            HID_RI_USAGE_PAGE(8, 0x01),    /* Generic Desktop */
+            HID_RI_USAGE(8, 0x30),         /* X */
+            HID_RI_USAGE(8, 0x31),         /* Y */
+            HID_RI_LOGICAL_MINIMUM(16, AXIS_MIN),
+            HID_RI_LOGICAL_MAXIMUM(16, AXIS_MAX),
+            HID_RI_PHYSICAL_MINIMUM(16, AXIS_MIN),
+            HID_RI_PHYSICAL_MAXIMUM(16, AXIS_MAX),
+            HID_RI_REPORT_COUNT(8, 0x02),
+            HID_RI_REPORT_SIZE(8, (((AXIS_MIN >= -128) && (AXIS_MAX <= 127)) ? 8 : 16)),
+            HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_RELATIVE),
+            HID_RI_COLLECTION(8, 0x02),    /* Logical */
+                HID_RI_REPORT_ID(8, REPORT_ID_ResolutionMultiplier),
+                HID_RI_USAGE(8, 0x48),     /* Resolution Multiplier */
+                HID_RI_LOGICAL_MINIMUM(8, 0x00),
+                HID_RI_LOGICAL_MAXIMUM(8, 0x01),
+                HID_RI_PHYSICAL_MINIMUM(8, 0x01),
+                HID_RI_PHYSICAL_MAXIMUM(8, WHEEL_RESOLUTION_MULTIPLIER),
+                HID_RI_REPORT_COUNT(8, 0x01),
+                HID_RI_REPORT_SIZE(8, 0x08),
+                HID_RI_FEATURE(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+                HID_RI_REPORT_ID(8, REPORT_ID_Mouse),
+                HID_RI_USAGE(8, 0x38),     /* Wheel */
+                HID_RI_LOGICAL_MINIMUM(8, -127),
+                HID_RI_LOGICAL_MAXIMUM(8, 127),
+                HID_RI_PHYSICAL_MINIMUM(8, 0x00),
+                HID_RI_PHYSICAL_MAXIMUM(8, 0x00),
+                HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_RELATIVE),
+            HID_RI_END_COLLECTION(0),
+        HID_RI_END_COLLECTION(0),
+    HID_RI_END_COLLECTION(0),
+
+    /*  Gamepad, used instead of the mouse report for joysticks. Each axis is
+        at its minimum, center or maximum.
+    */
+    HID_RI_USAGE_PAGE(8, 0x01),            /* Generic Desktop */
+    HID_RI_USAGE(8, 0x05),                 /* Gamepad */
+    HID_RI_COLLECTION(8, 0x01),            /* Application */
+        HID_RI_REPORT_ID(8, REPORT_ID_Gamepad),
+        HID_RI_USAGE_PAGE(8, 0x09),        /* Button */
+        HID_RI_USAGE_MINIMUM(8, 0x01),
+        HID_RI_USAGE_MAXIMUM(8, GAMEPAD_BUTTONS),
+        HID_RI_LOGICAL_MINIMUM(8, 0x00),
+        HID_RI_LOGICAL_MAXIMUM(8, 0x01),
+        HID_RI_REPORT_COUNT(8, GAMEPAD_BUTTONS),
+        HID_RI_REPORT_SIZE(8, 0x01),
+        HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+        HID_RI_REPORT_COUNT(8, 0x01),
+        HID_RI_REPORT_SIZE(8, (GAMEPAD_BUTTONS % 8) ? (8 - (GAMEPAD_BUTTONS % 8)) : 0),
+        HID_RI_INPUT(8, HID_IOF_CONSTANT),
+        HID_RI_USAGE_PAGE(8, 0x01),        /* Generic Desktop */
+        HID_RI_USAGE(8, 0x30),             /* X */
+        HID_RI_USAGE(8, 0x31),             /* Y */
+        HID_RI_LOGICAL_MINIMUM(16, -GAMEPAD_AXIS_MAX),
+        HID_RI_LOGICAL_MAXIMUM(16, GAMEPAD_AXIS_MAX),
+        HID_RI_REPORT_COUNT(8, 0x02),
+        HID_RI_REPORT_SIZE(8, 16),
+        HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+    HID_RI_END_COLLECTION(0),
+
+    /*  Absolute pointer, used instead of the mouse report for touch
+        tablets. Same as HID_DESCRIPTOR_MOUSE with AbsoluteCoords=true.
+    */
+    HID_RI_USAGE_PAGE(8, 0x01),            /* Generic Desktop */
+    HID_RI_USAGE(8, 0x02),                 /* Mouse */
+    HID_RI_COLLECTION(8, 0x01),            /* Application */
+        HID_RI_REPORT_ID(8, REPORT_ID_Tablet),
+        HID_RI_USAGE(8, 0x01),             /* Pointer */
+        HID_RI_COLLECTION(8, 0x00),        /* Physical */
+            HID_RI_USAGE_PAGE(8, 0x09),    /* Button */
+            HID_RI_USAGE_MINIMUM(8, 0x01),
+            HID_RI_USAGE_MAXIMUM(8, BUTTONS),
+            HID_RI_LOGICAL_MINIMUM(8, 0x00),
+            HID_RI_LOGICAL_MAXIMUM(8, 0x01),
+            HID_RI_REPORT_COUNT(8, BUTTONS),
+            HID_RI_REPORT_SIZE(8, 0x01),
+            HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+            HID_RI_REPORT_COUNT(8, 0x01),
+            HID_RI_REPORT_SIZE(8, (BUTTONS % 8) ? (8 - (BUTTONS % 8)) : 0),
+            HID_RI_INPUT(8, HID_IOF_CONSTANT),
+            HID_RI_USAGE_PAGE(8, 0x01),    /* Generic Desktop */
+            HID_RI_USAGE(8, 0x30),         /* X */
+            HID_RI_USAGE(8, 0x31),         /* Y */
+            HID_RI_LOGICAL_MINIMUM(8, 0x00),
+            HID_RI_LOGICAL_MAXIMUM(16, TABLET_AXIS_MAX),
+            HID_RI_REPORT_COUNT(8, 0x02),
+            HID_RI_REPORT_SIZE(8, 16),
+            HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+        HID_RI_END_COLLECTION(0),
+    HID_RI_END_COLLECTION(0),
+
+    /*  Vendor-defined adapter settings, read and written by the host as a
+        feature report. The contents are an AdapterSettings struct. The
+        one-byte command report takes a SETTINGS_COMMAND_* value.
+    */
+    HID_RI_USAGE_PAGE(16, (0xFF00 | SETTINGS_VENDOR_PAGE)),
+    HID_RI_USAGE(8, 0x01),
+    HID_RI_COLLECTION(8, 0x01),            /* Application */
+        HID_RI_REPORT_ID(8, REPORT_ID_Settings),
+        HID_RI_USAGE(8, 0x02),
+        HID_RI_LOGICAL_MINIMUM(8, 0x00),
+        HID_RI_LOGICAL_MAXIMUM(16, 0xFF),
+        HID_RI_REPORT_SIZE(8, 0x08),
+        HID_RI_REPORT_COUNT(8, SETTINGS_REPORT_SIZE),
+        HID_RI_FEATURE(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+        HID_RI_REPORT_ID(8, REPORT_ID_SettingsCommand),
+        HID_RI_USAGE(8, 0x03),
+        HID_RI_REPORT_COUNT(8, 0x01),
+        HID_RI_FEATURE(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+        HID_RI_REPORT_ID(8, REPORT_ID_Status),
+        HID_RI_USAGE(8, 0x04),
+        HID_RI_REPORT_COUNT(8, STATUS_REPORT_SIZE),
+        HID_RI_FEATURE(8, HID_IOF_CONSTANT | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+    HID_RI_END_COLLECTION(0)
 };
 
+#ifdef ENABLE_KEYBOARD
+/** HID class report descriptor of the keyboard interface, the standard boot keyboard report. */
+const USB_Descriptor_HIDReport_Datatype_t PROGMEM KeyboardReport[] = {
+    HID_DESCRIPTOR_KEYBOARD(KEYBOARD_KEYS)
+};
+#endif
+
 /** Device descriptor structure. This descriptor, located in FLASH memory, describes the overall
     device characteristics, including the supported USB version, control endpoint size and the
     number of device configurations. The descriptor is read out by the USB host when the enumeration
@@ -99,16 +234,13 @@ const USB_Descriptor_Configuration_t PROGMEM ConfigurationDescriptor = {
         .Header                 = {.Size = sizeof(USB_Descriptor_Configuration_Header_t), .Type = DTYPE_Configuration},
 
         .TotalConfigurationSize = sizeof(USB_Descriptor_Configuration_t),
-#ifdef ENABLE_VIRTUAL_SERIAL
-        .TotalInterfaces        = 3,
-#else
-        .TotalInterfaces        = 1,
-#endif
+        .TotalInterfaces        = INTERFACE_COUNT,
 
         .ConfigurationNumber    = 1,
         .ConfigurationStrIndex  = NO_DESCRIPTOR,
 
-        .ConfigAttributes       = (USB_CONFIG_ATTR_RESERVED | USB_CONFIG_ATTR_SELFPOWERED),
+        .ConfigAttributes       = (USB_CONFIG_ATTR_RESERVED | USB_CONFIG_ATTR_SELFPOWERED |
+                                   USB_CONFIG_ATTR_REMOTEWAKEUP),
 
         .MaxPowerConsumption    = USB_CONFIG_POWER_MA(100)
     },
@@ -254,7 +386,46 @@ const USB_Descriptor_Configuration_t PROGMEM ConfigurationDescriptor = {
          * or ISOCHRONOUS type.
          */
         .PollingIntervalMS      = 0x05
-    }
+    },
+
+#ifdef ENABLE_KEYBOARD
+    .HID_KeyboardInterface =
+    {
+        .Header                 = {.Size = sizeof(USB_Descriptor_Interface_t), .Type = DTYPE_Interface},
+
+        .InterfaceNumber        = INTERFACE_ID_Keyboard,
+        .AlternateSetting       = 0,
+
+        .TotalEndpoints         = 1,
+
+        .Class                  = HID_CSCP_HIDClass,
+        .SubClass               = HID_CSCP_BootSubclass,
+        .Protocol               = HID_CSCP_KeyboardBootProtocol,
+
+        .InterfaceStrIndex      = NO_DESCRIPTOR
+    },
+
+    .HID_KeyboardHID =
+    {
+        .Header                 = {.Size = sizeof(USB_HID_Descriptor_HID_t), .Type = HID_DTYPE_HID},
+
+        .HIDSpec                = VERSION_BCD(1, 1, 1),
+        .CountryCode            = 0x00,
+        .TotalReportDescriptors = 1,
+        .HIDReportType          = HID_DTYPE_Report,
+        .HIDReportLength        = sizeof(KeyboardReport)
+    },
+
+    .HID_KeyboardReportINEndpoint =
+    {
+        .Header                 = {.Size = sizeof(USB_Descriptor_Endpoint_t), .Type = DTYPE_Endpoint},
+
+        .EndpointAddress        = KEYBOARD_EPADDR,
+        .Attributes             = (EP_TYPE_INTERRUPT | ENDPOINT_ATTR_NO_SYNC | ENDPOINT_USAGE_DATA),
+        .EndpointSize           = KEYBOARD_EPSIZE,
+        .PollingIntervalMS      = 0x05
+    },
+#endif
 };
 
 /** Language descriptor structure. This descriptor, located in FLASH memory, is returned when the host requests
@@ -326,11 +497,25 @@ uint16_t CALLBACK_USB_GetDescriptor(const uint16_t wValue,
             break;
 
         case HID_DTYPE_HID:
+#ifdef ENABLE_KEYBOARD
+            if (wIndex == INTERFACE_ID_Keyboard) {
+                Address = &ConfigurationDescriptor.HID_KeyboardHID;
+                Size    = sizeof(USB_HID_Descriptor_HID_t);
+                break;
+            }
+#endif
             Address = &ConfigurationDescriptor.HID_MouseHID;
             Size    = sizeof(USB_HID_Descriptor_HID_t);
             break;
 
         case HID_DTYPE_Report:
+#ifdef ENABLE_KEYBOARD
+            if (wIndex == INTERFACE_ID_Keyboard) {
+                Address = &KeyboardReport;
+                Size    = sizeof(KeyboardReport);
+                break;
+            }
+#endif
             Address = &MouseReport;
             Size    = sizeof(MouseReport);
             break;
@@ -0,0 +1,150 @@
+#include <stdlib.h>
+
+#include "controller.hpp"
+#include "detection.hpp"
+#include "quadrature.hpp"
+#include "settings.h"
+
+
+namespace c1351_mouse {
+
+// Pairs of opposing directions; both low at once means a quadrature mouse
+const uint8_t LINES_UP_DOWN = _BV(QUAD_LINE_1) | _BV(QUAD_LINE_2);
+const uint8_t LINES_LEFT_RIGHT = _BV(QUAD_LINE_3) | _BV(QUAD_LINE_4);
+
+
+static bool isQuadratureDevice(uint8_t device)
+{
+    return device == DEVICE_AMIGA || device == DEVICE_ATARI_ST;
+}
+
+
+uint8_t InputDetector::update(bool pots_read, bool capture_valid, uint8_t lines,
+                              bool button_pressed)
+{
+    uint8_t low = ~lines & DIRECTION_LINES_MASK;
+    uint8_t prev_lines = lastLines;
+    bool changed = lines != prev_lines;
+
+    lastLines = lines;
+
+    if (device == DEVICE_C1351) {
+        // the direction lines carry the right button, ignore them
+        if (pots_read) {
+            if (capture_valid) {
+                captureCount = 0;
+            }
+            else if (++captureCount >= DETECT_C1351_LOST_CYCLES) {
+                setDevice(DEVICE_NONE);
+            }
+        }
+        return device;
+    }
+
+    if (pots_read) {
+        if (!capture_valid) {
+            captureCount = 0;
+        }
+        else if (++captureCount >= DETECT_C1351_CYCLES) {
+            lastQuadratureDevice = DEVICE_NONE;
+            idleDevice = DEVICE_NONE;
+            setDevice(DEVICE_C1351);
+            return device;
+        }
+    }
+
+    // a mouse or joystick held still with a button down is still in use
+    if (low || changed || button_pressed) {
+        idleCount = 0;
+    }
+    else if (device != DEVICE_NONE && ++idleCount >= DETECT_IDLE_CYCLES) {
+        idleDevice = device;
+        setDevice(DEVICE_NONE);
+        return device;
+    }
+
+    // a click after the device was left still
+    if (device == DEVICE_NONE && button_pressed && idleDevice != DEVICE_NONE) {
+        setDevice(idleDevice);
+        return device;
+    }
+
+    if (isQuadratureDevice(device)) {
+        return device;
+    }
+
+    if (layoutChanges) {
+        if (changed) {
+            decodeLayouts(prev_lines, lines);
+            if (--layoutChanges == 0) {
+                lastQuadratureDevice = chooseLayout();
+                setDevice(lastQuadratureDevice);
+            }
+        }
+    }
+    else if ((low & LINES_UP_DOWN) == LINES_UP_DOWN ||
+             (low & LINES_LEFT_RIGHT) == LINES_LEFT_RIGHT) {
+        if (lastQuadratureDevice != DEVICE_NONE) {
+            setDevice(lastQuadratureDevice);
+        }
+        else {
+            layoutChanges = DETECT_LAYOUT_CHANGES;
+            amigaX = amigaY = atariX = atariY = 0;
+        }
+    }
+    else if (low && device == DEVICE_NONE) {
+        setDevice(DEVICE_JOYSTICK);
+    }
+
+    return device;
+}
+
+
+uint8_t InputDetector::getDevice() const
+{
+    return device;
+}
+
+
+bool InputDetector::isProbing() const
+{
+    // not while a joystick is used, since DB9 pin 9 is its second button
+    return device == DEVICE_NONE;
+}
+
+
+void InputDetector::setDevice(uint8_t new_device)
+{
+    device = new_device;
+    captureCount = 0;
+    idleCount = 0;
+    layoutChanges = 0;
+}
+
+
+static void addStep(uint8_t step, int16_t& x, int16_t& y)
+{
+    x += (step & QUAD_X_INC) ? 1 : (step & QUAD_X_DEC) ? -1 : 0;
+    y += (step & QUAD_Y_INC) ? 1 : (step & QUAD_Y_DEC) ? -1 : 0;
+}
+
+
+/* Decode a line change with both pinouts. With the wrong pinout, each axis
+ * pairs lines of different axes, which decodes as steps back and forth.
+ */
+void InputDetector::decodeLayouts(uint8_t prev_lines, uint8_t lines)
+{
+    addStep(getQuadratureStep(INPUT_MODE_AMIGA, prev_lines, lines), amigaX, amigaY);
+    addStep(getQuadratureStep(INPUT_MODE_ATARI_ST, prev_lines, lines), atariX, atariY);
+}
+
+
+uint8_t InputDetector::chooseLayout() const
+{
+    int16_t amiga = abs(amigaX) + abs(amigaY);
+    int16_t atari = abs(atariX) + abs(atariY);
+
+    return atari > amiga ? DEVICE_ATARI_ST : DEVICE_AMIGA;
+}
+
+}
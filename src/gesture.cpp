@@ -0,0 +1,71 @@
+#include <stdlib.h>
+
+#include "gesture.hpp"
+#include "settings.h"
+
+
+namespace c1351_mouse {
+
+/* Add a movement to a sum, saturating instead of wrapping */
+static int16_t addSaturated(int16_t sum, int16_t value)
+{
+    int32_t total = (int32_t)sum + value;
+    return total > 0x7fff ? 0x7fff : total < -0x7fff ? -0x7fff : total;
+}
+
+
+uint8_t GestureDetector::update(int16_t& x, int16_t& y, uint8_t& buttons)
+{
+    const uint8_t mask = adapter_settings.GestureButtons;
+    uint8_t trigger = buttons & mask;
+    uint8_t flick = GESTURE_NONE;
+
+    if (!active && trigger) {
+        active = true;
+        heldButtons = 0;
+        sumX = 0;
+        sumY = 0;
+    }
+
+    if (!active) {
+        return GESTURE_NONE;
+    }
+
+    heldButtons |= trigger;
+    sumX = addSaturated(sumX, x);
+    sumY = addSaturated(sumY, y);
+    x = 0;
+    y = 0;
+    buttons &= ~mask;
+
+    if (!trigger) {
+        active = false;
+        flick = getFlick();
+        if (flick == GESTURE_NONE) {
+            // no flick: send the withheld click, which is released with the
+            // next report
+            buttons |= heldButtons;
+        }
+    }
+
+    return flick;
+}
+
+
+uint8_t GestureDetector::getFlick() const
+{
+    int16_t distance_x = abs(sumX);
+    int16_t distance_y = abs(sumY);
+
+    if (distance_x >= distance_y && distance_x >= GESTURE_FLICK_DISTANCE) {
+        return sumX < 0 ? KEY_BINDING_FLICK_LEFT : KEY_BINDING_FLICK_RIGHT;
+    }
+
+    if (distance_y >= GESTURE_FLICK_DISTANCE) {
+        return sumY < 0 ? KEY_BINDING_FLICK_UP : KEY_BINDING_FLICK_DOWN;
+    }
+
+    return GESTURE_NONE;
+}
+
+}
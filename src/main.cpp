@@ -10,78 +10,541 @@
  *   - send mouse movement cmd over USB
  *   - send mouse clicks over USB (combine w/ above if possible)
  *
+ * - Amiga and Atari ST mice are decoded by the quadrature line interrupts
+ *   instead, and only the report part of the main interrupt is used
+ *
+ * - With INPUT_MODE_AUTO, detect the connected device once per cycle, and
+ *   only probe for a C1351 every few ms while none is connected
+ *
+ * - While the USB bus is suspended, read the C1351 only every few ms, and
+ *   wake the host on motion or a button press
+ *
  * Timers used:
  *  Timer 4 (main 256 uS interrupt)
  */
 
+#include <stdlib.h>
+
+#include "capture_blocker.h"
+#include "capture_trace.h"
 #include "controller.hpp"
+#include "detection.hpp"
 #include "mouse.h"
+#include "quadrature.hpp"
+#include "read_phase.hpp"
+#include "report_builder.hpp"
+#include "status.h"
+#include "timer_config.hpp"
+
+
+const uint32_t MAIN_INTERRUPT_INTERVAL_US = 256;
+typedef c1351_mouse::Timer4Config<F_CPU, MAIN_INTERRUPT_INTERVAL_US> MainTimer;
+// The USB mouse velocity is updated every adapter_settings.ReportInterval
+// C1351 read cycles
 
+// Shortest time from changing the interval length to its end, so that
+// OCR4C is written before timer 4 reaches it (see setIntervalUs())
+const uint8_t INTERVAL_MARGIN_TICKS = c1351_mouse::usToTicks(F_CPU, MainTimer::PRESCALE, 2) + 1;
 
-const int MAIN_INTERRUPT_INTERVAL_US = 256;
-// Update the USB mouse velocity after this many C1351 read cycles
-const uint8_t MOUSE_UPDATE_INTERVAL = 40;
+// Paddles and tablets are read for this many extra main interrupt intervals
+// per read cycle, so that slowly charging pots are still measured
+const uint8_t PADDLE_EXTRA_READ_INTERVALS = 1;
+// While the USB bus is suspended, wait this many main interrupt intervals
+// between C1351 read cycles (~16 ms)
+const uint8_t SUSPEND_IDLE_INTERVAL = 64;
+// Minimum motion (in mouse counts) per suspended read cycle that wakes the host
+const int SUSPEND_WAKEUP_THRESHOLD = 2;
 
 
-using c1351_mouse::C1351Interface;
+using namespace c1351_mouse;
 
 
 C1351Interface c1351;
+QuadratureInterface quadrature;
+JoystickInterface joystick;
+PaddleInterface paddles;
+TabletInterface tablet;
+InputDetector detector;
+MouseReportBuilder report_builder;
+ReadPhaseTuner read_phase;
+// DEVICE_* currently in use, see setDevice()
+uint8_t device = DEVICE_NONE;
 
 /* Mode for the main interrupt. Toggles between discharging and reading the
  * POTX/POTY pins.
  */
 enum {
     POT_MODE_DISCHARGE = 0,
-    POT_MODE_READ
+    POT_MODE_READ,
+    POT_MODE_IDLE  // only used while suspended, and to extend paddle reads
 };
 
 
-/* Update the USB mouse report values to be sent. Returns true if values
- * changed since last called.
+static_assert(READ_PHASE_TIMEOUT_US == MAIN_INTERRUPT_INTERVAL_US,
+              "the full read phase is one main interrupt interval");
+static_assert(TABLET_POSITION_MAX == TABLET_AXIS_MAX,
+              "tablet positions must cover the tablet report range");
+
+
+/* Returns true if the current device is read with the PaddleInterface */
+bool usesPaddles()
+{
+    return device == DEVICE_PADDLES || device == DEVICE_TABLET;
+}
+
+
+/* Stop the interface of the current device and start the one of the new
+ * device. No interface is used for DEVICE_NONE.
+ */
+void setDevice(uint8_t new_device)
+{
+    if (device == DEVICE_C1351) {
+        c1351.stop();
+    }
+    else if (device == DEVICE_AMIGA || device == DEVICE_ATARI_ST) {
+        quadrature.stop();
+    }
+    else if (usesPaddles()) {
+        paddles.stop();
+    }
+
+    if (device == DEVICE_TABLET) {
+        // release the buttons, and keep the pointer where the tablet left it
+        setUsbTablet(tablet.getPositionX(), tablet.getPositionY(), 0);
+    }
+
+    device = new_device;
+
+    if (device == DEVICE_C1351) {
+        c1351.init();
+    }
+    else if (device == DEVICE_AMIGA) {
+        quadrature.init(INPUT_MODE_AMIGA);
+    }
+    else if (device == DEVICE_ATARI_ST) {
+        quadrature.init(INPUT_MODE_ATARI_ST);
+    }
+    else if (device == DEVICE_JOYSTICK) {
+        joystick.init();
+    }
+    else if (device == DEVICE_PADDLES) {
+        paddles.init();
+    }
+    else if (device == DEVICE_TABLET) {
+        paddles.init();
+        tablet.init();
+    }
+}
+
+
+/* True if a button line is low: DB9 pin 6, and pin 9 unless it is used to
+ * probe for a C1351.
+ */
+bool readButtonPressed()
+{
+    C1351_IO io_pin;
+
+    return !io_pin.btn1.read() || (!detector.isProbing() && !io_pin.btn2_potx.read());
+}
+
+
+/* Choose the device for this cycle, from the input mode setting or by
+ * detection. pots_read is true if a C1351 read cycle ended in this cycle.
+ */
+void selectDevice(bool pots_read)
+{
+    uint8_t new_device;
+
+    switch (adapter_settings.InputMode) {
+    case INPUT_MODE_C1351:
+        new_device = DEVICE_C1351;
+        break;
+    case INPUT_MODE_AMIGA:
+        new_device = DEVICE_AMIGA;
+        break;
+    case INPUT_MODE_ATARI_ST:
+        new_device = DEVICE_ATARI_ST;
+        break;
+    case INPUT_MODE_JOYSTICK:
+        new_device = DEVICE_JOYSTICK;
+        break;
+    case INPUT_MODE_PADDLES:
+        new_device = DEVICE_PADDLES;
+        break;
+    case INPUT_MODE_TABLET:
+        new_device = DEVICE_TABLET;
+        break;
+    default:
+        new_device = detector.update(pots_read, c1351.isCaptureValid(),
+                                     readDirectionLines(), readButtonPressed());
+        break;
+    }
+
+    if (new_device != device) {
+        setDevice(new_device);
+    }
+}
+
+
+/* Time between two mouse reports. Only the C1351 read phase is
+ * shortened (see read_phase.hpp), the other mice read in full phases.
+ */
+uint32_t getReportIntervalUs()
+{
+    const uint16_t read_us = device == DEVICE_C1351 ? read_phase.getReadUs() :
+                             MAIN_INTERRUPT_INTERVAL_US;
+
+    return (uint32_t)adapter_settings.ReportInterval * (MAIN_INTERRUPT_INTERVAL_US + read_us);
+}
+
+
+/* Update the USB mouse report values to be sent. */
+template<typename Mouse>
+void updateUsbMouse(const Mouse& mouse)
+{
+    report_builder.update(mouse.getVelocityX(), mouse.getVelocityY(), mouse.getLeftButtonValue(),
+                          mouse.getRightButtonValue(), getWheelMultiplier(),
+                          getReportIntervalUs());
+}
+
+
+/* Update the USB gamepad report values to be sent. */
+void updateUsbGamepad(const JoystickInterface& joystick)
+{
+    uint8_t buttons = 0;
+
+    if (joystick.getLeftButtonValue()) {
+        buttons |= 1 << 0;
+    }
+
+    if (joystick.getRightButtonValue()) {
+        buttons |= 1 << 1;
+    }
+
+    setUsbGamepad(joystick.getDirectionX() * GAMEPAD_AXIS_MAX,
+                  joystick.getDirectionY() * GAMEPAD_AXIS_MAX, buttons);
+}
+
+
+/* Map a paddle value to a gamepad axis */
+int16_t paddleToAxis(uint16_t value)
+{
+    return (int32_t)value * (2L * GAMEPAD_AXIS_MAX) / PADDLE_VALUE_MAX - GAMEPAD_AXIS_MAX;
+}
+
+
+void updateUsbGamepad(const PaddleInterface& paddles)
+{
+    uint8_t buttons = 0;
+
+    if (paddles.getFireXValue()) {
+        buttons |= 1 << 0;
+    }
+
+    if (paddles.getFireYValue()) {
+        buttons |= 1 << 1;
+    }
+
+    setUsbGamepad(paddleToAxis(paddles.getValueX()), paddleToAxis(paddles.getValueY()),
+                  buttons);
+}
+
+
+void updateUsbTablet(const TabletInterface& tablet)
+{
+    uint8_t buttons = 0;
+
+    if (tablet.getLeftButtonValue()) {
+        buttons |= adapter_settings.ButtonMap[BUTTON_INDEX_LEFT];
+    }
+
+    if (tablet.getRightButtonValue()) {
+        buttons |= adapter_settings.ButtonMap[BUTTON_INDEX_RIGHT];
+    }
+
+    setUsbTablet(tablet.getPositionX(), tablet.getPositionY(), buttons);
+}
+
+
+/* Update the mouse state and the USB reports. Only one of the mouse,
+ * gamepad and tablet reports is used at a time, the others are kept idle.
+ */
+void updateMouse()
+{
+    bool use_gamepad = device == DEVICE_PADDLES ||
+                       (device == DEVICE_JOYSTICK &&
+                        adapter_settings.JoystickOutput == JOYSTICK_OUTPUT_GAMEPAD);
+
+    if (device == DEVICE_C1351) {
+        c1351.update();
+        updateUsbMouse(c1351);
+    }
+    else if (device == DEVICE_AMIGA || device == DEVICE_ATARI_ST) {
+        quadrature.update();
+        updateUsbMouse(quadrature);
+    }
+    else if (device == DEVICE_JOYSTICK) {
+        joystick.update();
+        if (use_gamepad) {
+            updateUsbGamepad(joystick);
+        }
+        else {
+            updateUsbMouse(joystick);
+        }
+    }
+    else if (device == DEVICE_PADDLES) {
+        paddles.update();
+        updateUsbGamepad(paddles);
+    }
+    else if (device == DEVICE_TABLET) {
+        paddles.update();
+        tablet.update(paddles);
+        updateUsbTablet(tablet);
+    }
+
+    if (use_gamepad || device == DEVICE_TABLET || device == DEVICE_NONE) {
+        setUsbMouse(0, 0, 0, 0);
+    }
+
+    if (!use_gamepad) {
+        setUsbGamepad(0, 0, 0);
+    }
+}
+
+
+/* Process USB. For quadrature mice, with the main interrupt masked but
+ * other interrupts enabled, so that quadrature edges are not missed while a
+ * control request is handled. If this takes longer than one interval, the
+ * main interrupt runs as soon as it is unmasked, as it would have without
+ * nesting.
+ *
+ * The USB general interrupt stays masked as well: a bus reset would select
+ * another endpoint, and a suspend would freeze the USB clock, in the middle
+ * of the USB task. Its flags are kept and handled after the task.
+ */
+void handleUsbNested()
+{
+    if (device != DEVICE_AMIGA && device != DEVICE_ATARI_ST) {
+        handleUsb();
+        return;
+    }
+
+    const uint8_t device_interrupts = UDIEN;
+    const uint8_t vbus_interrupt = USBCON & _BV(VBUSTE);
+
+    UDIEN = 0;
+    USBCON &= ~_BV(VBUSTE);
+    TIMSK4 &= ~_BV(OCIE4A);
+    sei();
+    handleUsb();
+    cli();
+    TIMSK4 |= _BV(OCIE4A);
+    // the USB task may have enabled the start of frame interrupt
+    UDIEN |= device_interrupts;
+    USBCON |= vbus_interrupt;
+}
+
+
+/* Set the length of the main interrupt interval that has just started.
+ * OCR4C is not buffered in normal mode, so it must still be above TCNT4:
+ * past it, timer 4 would count on to its 10-bit maximum. If the interrupt
+ * ran late, the interval ends INTERVAL_MARGIN_TICKS from now instead.
+ */
+void setIntervalUs(uint16_t us)
+{
+    uint8_t top = (uint32_t)us * MainTimer::TICKS / MAIN_INTERRUPT_INTERVAL_US - 1;
+    // TCNT4 never exceeds MainTimer::TOP, so the high byte is 0
+    const uint16_t earliest = TCNT4 + INTERVAL_MARGIN_TICKS;
+
+    if (top < earliest) {
+        top = earliest < MainTimer::TOP ? earliest : MainTimer::TOP;
+    }
+
+    OCR4C = top;
+    OCR4A = top;
+}
+
+
+#ifdef ENABLE_CAPTURE_TRACE
+extern "C" uint16_t getTraceCycleUs()
+{
+    return MAIN_INTERRUPT_INTERVAL_US + read_phase.getReadUs();
+}
+
+
+/* Queue the captures of the C1351 read cycle that ends now for the capture
+ * trace. Call before C1351Interface::setModeSync() disarms the captures.
+ */
+void traceC1351Cycle()
+{
+    C1351_IO io_pin;
+    uint8_t flags = 0;
+
+    if (!timerRunning(Board::POTX_TIMER)) {
+        flags |= TRACE_FLAG_X_CAPTURED;
+    }
+    if (!timerRunning(Board::POTY_TIMER)) {
+        flags |= TRACE_FLAG_Y_CAPTURED;
+    }
+    if (!io_pin.btn1.read()) {
+        flags |= TRACE_FLAG_LEFT;
+    }
+    if (!io_pin.up_btn2.read()) {
+        flags |= TRACE_FLAG_RIGHT;
+    }
+
+    queueTraceRecord(getInputCaptureTimestamp(Board::POTX_TIMER),
+                     getInputCaptureTimestamp(Board::POTY_TIMER), flags);
+}
+#endif
+
+
+extern "C" void getAdapterStatus(AdapterStatus* status)
+{
+    status->SyncPhaseUs = MAIN_INTERRUPT_INTERVAL_US;
+    read_phase.getStatus(*status);
+    status->QuadratureErrors = getQuadratureErrors();
+}
+
+
+/* Motion detection while the USB bus is suspended. Call after each
+ * suspended C1351 read cycle. The first call after entering suspend only
+ * discards motion that was accumulated before the bus was suspended.
  */
-void updateUsbMouse()
+template<typename Mouse>
+void pollSuspended(Mouse& mouse, bool entered_suspend)
+{
+    mouse.update();
+
+    if (entered_suspend) {
+        return;
+    }
+
+    int x = mouse.getVelocityX();
+    int y = mouse.getVelocityY();
+    bool moved = abs(x) >= SUSPEND_WAKEUP_THRESHOLD ||
+                 abs(y) >= SUSPEND_WAKEUP_THRESHOLD;
+
+    if (moved || mouse.getLeftButtonValue() || mouse.getRightButtonValue()) {
+        requestRemoteWakeup();
+    }
+}
+
+
+void pollSuspended(bool entered_suspend)
 {
-    auto x = c1351.getVelocityX();
-    auto y = c1351.getVelocityY();
-    uint8_t lbutton = c1351.getLeftButtonValue();
-    uint8_t rbutton = c1351.getRightButtonValue();
-    uint8_t buttons = lbutton | (rbutton << 1);
-    setUsbMouse(x, y, buttons);
+    if (device == DEVICE_C1351) {
+        pollSuspended(c1351, entered_suspend);
+    }
+    else if (device == DEVICE_AMIGA || device == DEVICE_ATARI_ST) {
+        pollSuspended(quadrature, entered_suspend);
+    }
+    else if (device == DEVICE_JOYSTICK) {
+        pollSuspended(joystick, entered_suspend);
+    }
 }
 
 
 ISR(TIMER4_COMPA_vect)
 {
     static uint8_t mode = POT_MODE_DISCHARGE;
-    static uint8_t interval_counter = MOUSE_UPDATE_INTERVAL;
+    static uint8_t interval_counter = 1;
+    static uint8_t idle_counter = 0;
+    static bool idle_suspended = false;  // idling because of suspend
+    static uint8_t probe_counter = 1;
+    static bool probing = false;  // C1351 read cycle while detecting
+    static bool was_suspended = false;
+
+    bool suspended = isUsbSuspended();
 
     if (mode == POT_MODE_DISCHARGE) {
-        c1351.setModeSync();
+        bool pots_read = false;
 
-        if (--interval_counter == 0) {
-            interval_counter = MOUSE_UPDATE_INTERVAL;
-            c1351.update();
-            updateUsbMouse();
-            handleUsb();
+        setIntervalUs(MAIN_INTERRUPT_INTERVAL_US);
+
+        // For quadrature mice, the phases only pace the USB reports
+        if (device == DEVICE_C1351) {
+#ifdef ENABLE_CAPTURE_TRACE
+            traceC1351Cycle();
+#endif
+            c1351.setModeSync();
+            read_phase.update(c1351.isCaptureValid(), c1351.getLatestEdgeUs());
+            pots_read = true;
+        }
+        else if (usesPaddles()) {
+            paddles.setModeSync();
+        }
+        else if (probing) {
+            c1351.stop();
+            probing = false;
+            pots_read = true;
+        }
+
+        selectDevice(pots_read);
+
+        if (device == DEVICE_JOYSTICK) {
+            joystick.scan();
+        }
+
+        if (adapter_settings.InputMode == INPUT_MODE_AUTO && detector.isProbing() &&
+                --probe_counter == 0) {
+            probe_counter = DETECT_PROBE_INTERVAL;
+            c1351.setModeSync();
+            probing = true;
+        }
+
+        if (suspended) {
+            pollSuspended(!was_suspended);
+            interval_counter = adapter_settings.ReportInterval;
+        }
+        else if (--interval_counter == 0) {
+            interval_counter = adapter_settings.ReportInterval;
+            updateMouse();
+            handleUsbNested();
         }
 
+        was_suspended = suspended;
         mode = POT_MODE_READ;
     }
-    else {  // POT_MODE_READ
-        c1351.setModeRead();
+    else if (mode == POT_MODE_READ) {
+        if (device == DEVICE_C1351 && !suspended) {
+            setIntervalUs(read_phase.getReadUs());
+        }
+
+        if (device == DEVICE_C1351 || probing) {
+            c1351.setModeRead();
+        }
+        else if (usesPaddles()) {
+            paddles.setModeRead();
+        }
+
+        idle_suspended = suspended;
 
-        mode = POT_MODE_DISCHARGE;
+        if (suspended) {
+            idle_counter = SUSPEND_IDLE_INTERVAL;
+            mode = POT_MODE_IDLE;
+        }
+        else if (usesPaddles()) {
+            idle_counter = PADDLE_EXTRA_READ_INTERVALS;
+            mode = POT_MODE_IDLE;
+        }
+        else {
+            mode = POT_MODE_DISCHARGE;
+        }
     }
+    else {  // POT_MODE_IDLE
+        if ((idle_suspended && !suspended) || --idle_counter == 0) {
+            mode = POT_MODE_DISCHARGE;
+        }
+    }
+
+    captureBlockerEnd();
 }
 
 
 /* Setup main control interrupt (Timer 4 compare A) */
-void setupMainInterrupt(int interval_us)
+void setupMainInterrupt()
 {
-    const int PRESCALE = 16;
-    // compare match register duration (desired # cycles minus 1)
-    const int OCR_COMPARE_VALUE = (F_CPU / 1000000.0 / PRESCALE) * interval_us - 1;
     cli();
     TCCR4A = 0;
     TCCR4B = 0;
@@ -89,8 +552,10 @@ void setupMainInterrupt(int interval_us)
     TCCR4D = 0;
     TCCR4E = 0;
     TCNT4  = 0;
-    OCR4A = OCR_COMPARE_VALUE;
-    TCCR4B |= _BV(CS42) | _BV(CS40);    // 16x prescale
+    // Timer 4 restarts after reaching OCR4C, which sets the period
+    OCR4C = MainTimer::TOP;
+    OCR4A = MainTimer::TOP;
+    TCCR4B |= MainTimer::CLOCK_SELECT;
     TIMSK4 |= _BV(OCIE4A);  // enable timer compare interrupt
     sei();
 }
@@ -118,11 +583,17 @@ void clearIO()
 int main(void)
 {
     clearIO();
+    loadSettings();
     setupUsbMouse();
     c1351.init();
-    setupMainInterrupt(MAIN_INTERRUPT_INTERVAL_US);
+    setupMainInterrupt();
 
     for (;;) {
+        handleSettingsCommand();
+        handleUsbSuspend();
+#ifdef ENABLE_CAPTURE_TRACE
+        sendTrace();
+#endif
     }
 
     return 0;
@@ -0,0 +1,73 @@
+#include "middle_button.hpp"
+#include "settings.h"
+
+
+namespace c1351_mouse {
+
+const uint8_t CHORD_BUTTONS = (1 << BUTTON_INDEX_LEFT) | (1 << BUTTON_INDEX_RIGHT);
+
+enum {
+    CHORD_IDLE = 0,
+    CHORD_PENDING,      // one button pressed, waiting for the other one
+    CHORD_MIDDLE,       // chord pressed, until both buttons are released
+    CHORD_PASSTHROUGH,  // no chord, until both buttons are released
+};
+
+
+void MiddleButtonEmulator::update(uint8_t& buttons, uint32_t elapsed_us)
+{
+    const uint32_t window_us = (uint32_t)adapter_settings.ChordWindow * 1000;
+    uint8_t pressed = buttons & CHORD_BUTTONS;
+
+    if (state == CHORD_IDLE && pressed) {
+        if (pressed == CHORD_BUTTONS) {
+            state = CHORD_MIDDLE;
+        }
+        else if (window_us) {
+            state = CHORD_PENDING;
+            firstButton = pressed;
+            elapsedUs = 0;
+        }
+        else {
+            state = CHORD_PASSTHROUGH;
+        }
+    }
+
+    switch (state) {
+    case CHORD_PENDING:
+        elapsedUs += elapsed_us;
+        if (pressed == CHORD_BUTTONS) {
+            state = CHORD_MIDDLE;
+        }
+        else if (!(pressed & firstButton)) {
+            // released, or switched to the other button: send the click,
+            // which is released with the next report
+            buttons = (buttons & ~CHORD_BUTTONS) | firstButton;
+            state = pressed ? CHORD_PASSTHROUGH : CHORD_IDLE;
+        }
+        else if (elapsedUs >= window_us) {
+            state = CHORD_PASSTHROUGH;
+        }
+        else {
+            buttons &= ~CHORD_BUTTONS;
+        }
+        break;
+
+    case CHORD_PASSTHROUGH:
+        if (!pressed) {
+            state = CHORD_IDLE;
+        }
+        break;
+    }
+
+    if (state == CHORD_MIDDLE) {
+        if (pressed) {
+            buttons = (buttons & ~CHORD_BUTTONS) | (1 << BUTTON_INDEX_MIDDLE);
+        }
+        else {
+            state = CHORD_IDLE;
+        }
+    }
+}
+
+}
@@ -34,11 +34,28 @@
     the demo and is responsible for the initial application hardware configuration.
 */
 
-#include "mouse.h"
-
+#include <util/atomic.h>
 
-volatile Mouse_Report mouse_report_data;
-volatile bool needs_update = true;
+#include "capture_blocker.h"
+#include "capture_trace.h"
+#include "mouse.h"
+#include "reports.h"
+#include "status.h"
+
+
+volatile bool wheel_high_resolution = false;
+#ifdef ENABLE_KEYBOARD
+/* Keystrokes waiting to be sent. Written by queueKeyStroke() and read by the
+   keyboard report callback, which both run in the main interrupt. */
+#define KEY_QUEUE_SIZE 8
+static KeyBinding key_queue[KEY_QUEUE_SIZE];
+static volatile uint8_t key_queue_head = 0;
+static volatile uint8_t key_queue_tail = 0;
+/* The last keyboard report pressed a key, the next one releases it */
+static bool key_pressed = false;
+#endif
+volatile bool usb_suspended = false;
+volatile bool remote_wakeup_pending = false;
 
 #ifdef ENABLE_VIRTUAL_SERIAL
 /** LUFA CDC Class driver interface configuration and state information. This structure is
@@ -83,8 +100,131 @@ void serialPrintNum(int16_t n)
 
 #endif
 
-/** Buffer to hold the previously generated Mouse HID report, for comparison purposes inside the HID class driver. */
-static uint8_t PrevMouseHIDReportBuffer[sizeof(Mouse_Report)];
+#ifdef ENABLE_CAPTURE_TRACE
+/* Trace bytes waiting to be sent, the header and then the records. Records
+   are queued by queueTraceRecord() in the main interrupt, and sent by
+   sendTrace() from the main loop, with interrupts disabled. */
+#define TRACE_QUEUE_SIZE 192
+static uint8_t trace_queue[TRACE_QUEUE_SIZE];
+static volatile uint8_t trace_queue_head = 0;
+static volatile uint8_t trace_queue_tail = 0;
+/* Read cycles lost since the last queued record */
+static uint8_t trace_skipped = 0;
+/* The host has the serial port open (DTR) */
+static volatile bool trace_host_ready = false;
+/* The trace header has been queued since the port was opened */
+static volatile bool trace_started = false;
+
+
+/* Append bytes to the trace queue. Returns false, and queues nothing, if
+   they do not fit. */
+static bool queueTraceData(const uint8_t* data, uint8_t size)
+{
+    uint8_t head = trace_queue_head;
+    uint8_t used = (TRACE_QUEUE_SIZE + head - trace_queue_tail) % TRACE_QUEUE_SIZE;
+
+    if (used + size >= TRACE_QUEUE_SIZE) {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < size; i++) {
+        trace_queue[head] = data[i];
+        head = (head + 1) % TRACE_QUEUE_SIZE;
+    }
+    trace_queue_head = head;
+    return true;
+}
+
+
+void queueTraceRecord(uint16_t pot_x, uint16_t pot_y, uint8_t flags)
+{
+    uint8_t record[CAPTURE_TRACE_RECORD_SIZE];
+
+    if (!trace_started) {
+        return;
+    }
+
+    record[0] = pot_x & 0xff;
+    record[1] = pot_x >> 8;
+    record[2] = pot_y & 0xff;
+    record[3] = pot_y >> 8;
+    record[4] = flags;
+    record[5] = trace_skipped;
+
+    if (!queueTraceData(record, sizeof(record))) {
+        if (trace_skipped < 0xff) {
+            trace_skipped++;
+        }
+        return;
+    }
+    trace_skipped = 0;
+}
+
+
+/* Start a new trace with its header, dropping what is still queued */
+static void startTrace(void)
+{
+    uint8_t header[CAPTURE_TRACE_HEADER_SIZE] = {0};
+    uint16_t cycle_us = getTraceCycleUs();
+
+    memcpy(header, CAPTURE_TRACE_MAGIC, 4);
+    header[4] = CAPTURE_TRACE_VERSION;
+    header[5] = F_CPU / 1000000;
+    header[6] = cycle_us & 0xff;
+    header[7] = cycle_us >> 8;
+    memcpy(header + 8, &adapter_settings, sizeof(AdapterSettings));
+
+    trace_queue_tail = trace_queue_head;
+    trace_skipped = 0;
+    queueTraceData(header, sizeof(header));
+    trace_started = true;
+}
+
+
+/* Write queued bytes to the CDC IN endpoint, as many as its bank takes
+   without waiting for the host. A full bank is sent at once, a partly
+   filled one by the next CDC_Device_USBTask(). */
+static void writeTraceQueue(void)
+{
+    Endpoint_SelectEndpoint(VirtualSerial_CDC_Interface.Config.DataINEndpoint.Address);
+
+    if (!Endpoint_IsINReady()) {
+        return;
+    }
+
+    while (trace_queue_tail != trace_queue_head && Endpoint_IsReadWriteAllowed()) {
+        Endpoint_Write_8(trace_queue[trace_queue_tail]);
+        trace_queue_tail = (trace_queue_tail + 1) % TRACE_QUEUE_SIZE;
+    }
+
+    if (!Endpoint_IsReadWriteAllowed()) {
+        Endpoint_ClearIN();
+    }
+}
+
+
+void sendTrace(void)
+{
+    /* The endpoints are also used by the USB task in the main interrupt */
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (trace_host_ready && USB_DeviceState == DEVICE_STATE_Configured) {
+            if (!trace_started) {
+                startTrace();
+            }
+            writeTraceQueue();
+        }
+
+        captureBlockerEnd();
+    }
+}
+#endif
+
+/** Buffer to hold the previously generated Mouse HID report, for comparison purposes inside the HID class driver.
+    The class driver also uses its size for the GET_REPORT buffer, so it must be able to hold the settings
+    and status feature reports as well.
+*/
+static uint8_t PrevMouseHIDReportBuffer[MAX_SIZE(MAX_IN_REPORT_SIZE,
+                                                 MAX_SIZE(SETTINGS_REPORT_SIZE, STATUS_REPORT_SIZE))];
 
 /** LUFA HID Class driver interface configuration and state information. This structure is
     passed to all HID Class driver functions, so that multiple instances of the same class
@@ -105,31 +245,71 @@ USB_ClassInfo_HID_Device_t Mouse_HID_Interface = {
     },
 };
 
+#ifdef ENABLE_KEYBOARD
+static uint8_t PrevKeyboardHIDReportBuffer[sizeof(USB_KeyboardReport_Data_t)];
 
-/* Set values of USB mouse. */
-void setUsbMouse(int8_t x, int8_t y, uint8_t button)
+/** LUFA HID Class driver interface of the keyboard. It has its own IN endpoint, so keystrokes
+    never hold back mouse reports.
+*/
+USB_ClassInfo_HID_Device_t Keyboard_HID_Interface = {
+    .Config =
+    {
+        .InterfaceNumber          = INTERFACE_ID_Keyboard,
+        .ReportINEndpoint         =
+        {
+            .Address              = KEYBOARD_EPADDR,
+            .Size                 = KEYBOARD_EPSIZE,
+            .Banks                = 1,
+        },
+        .PrevReportINBuffer       = PrevKeyboardHIDReportBuffer,
+        .PrevReportINBufferSize   = sizeof(PrevKeyboardHIDReportBuffer),
+    },
+};
+#endif
+
+
+uint8_t getWheelMultiplier(void)
 {
-    if (x || x != mouse_report_data.X) {
-        mouse_report_data.X = x;
-        needs_update = true;
-    }
+    return wheel_high_resolution ? WHEEL_RESOLUTION_MULTIPLIER : 1;
+}
 
-    if (y || y != mouse_report_data.Y) {
-        mouse_report_data.Y = y;
-        needs_update = true;
-    }
 
-    if (button != mouse_report_data.Button) {
-        mouse_report_data.Button = button;
-        needs_update = true;
+#ifdef ENABLE_KEYBOARD
+bool queueKeyStroke(uint8_t modifier, uint8_t key_code)
+{
+    uint8_t next = (key_queue_head + 1) % KEY_QUEUE_SIZE;
+
+    if (next == key_queue_tail) {
+        return false;
     }
+
+    key_queue[key_queue_head].Modifier = modifier;
+    key_queue[key_queue_head].KeyCode = key_code;
+    key_queue_head = next;
+    return true;
 }
 
 
-void initMouseReportData(void)
+/* Keyboard input report: press the next queued keystroke, and release it
+   with the following report */
+static bool createKeyboardReport(USB_KeyboardReport_Data_t* report)
 {
-    setUsbMouse(0, 0, 0);
+    if (key_pressed) {
+        key_pressed = false;
+        return true;
+    }
+
+    if (key_queue_tail == key_queue_head) {
+        return false;
+    }
+
+    report->Modifier = key_queue[key_queue_tail].Modifier;
+    report->KeyCode[0] = key_queue[key_queue_tail].KeyCode;
+    key_queue_tail = (key_queue_tail + 1) % KEY_QUEUE_SIZE;
+    key_pressed = true;
+    return true;
 }
+#endif
 
 
 void setupUsbMouse(void)
@@ -150,9 +330,12 @@ inline void handleUsb(void)
     //char report_string[16];
     //sprintf(report_string, "%d", 42);
 
+#ifndef ENABLE_CAPTURE_TRACE
+    /* The trace, sent from the main loop, takes the whole serial stream */
     if (serial_data_waiting) {
         CDC_Device_SendString(&VirtualSerial_CDC_Interface, serial_out_str);
     }
+#endif
 
     /* Must throw away unused bytes from the host, or it will lock up while waiting for the device */
     CDC_Device_ReceiveByte(&VirtualSerial_CDC_Interface);
@@ -163,6 +346,9 @@ inline void handleUsb(void)
         the main program loop, before the master USB management task USB_USBTask().
     */
     HID_Device_USBTask(&Mouse_HID_Interface);
+#ifdef ENABLE_KEYBOARD
+    HID_Device_USBTask(&Keyboard_HID_Interface);
+#endif
     /*  This is the main USB management task. The USB driver requires this task to be
         executed continuously when the USB system is active (device attached in host
         mode, or attached to a host in device mode) in order to manage USB communications.
@@ -179,6 +365,43 @@ inline void handleUsb(void)
 }
 
 
+bool isUsbSuspended(void)
+{
+    return usb_suspended;
+}
+
+
+void requestRemoteWakeup(void)
+{
+    if (usb_suspended) {
+        remote_wakeup_pending = true;
+    }
+}
+
+
+/** Called in the main loop to handle the suspended USB bus. The remote wakeup
+    is signalled from here rather than from the requesting interrupt, since
+    USB_Device_SendRemoteWakeup() busy-waits until the resume signal is done.
+*/
+void handleUsbSuspend(void)
+{
+    if (!usb_suspended) {
+        return;
+    }
+
+    if (remote_wakeup_pending && USB_Device_RemoteWakeupEnabled) {
+        remote_wakeup_pending = false;
+        USB_Device_SendRemoteWakeup();
+        return;
+    }
+
+    /* Idle until the next interrupt. The USB clock is already frozen by the
+       library, and the main interrupt only runs the slow motion-detect poll. */
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    sleep_mode();
+}
+
+
 /** Configures the board hardware and chip peripherals */
 void SetupHardware(void)
 {
@@ -215,15 +438,40 @@ void EVENT_USB_Device_Connect(void)
 /** Event handler for the library USB Disconnection event. */
 void EVENT_USB_Device_Disconnect(void)
 {
+    usb_suspended = false;
     LEDs_SetAllLEDs(LEDMASK_USB_NOTREADY);
 }
 
+/** Event handler for the library USB Suspend event. */
+void EVENT_USB_Device_Suspend(void)
+{
+    usb_suspended = true;
+    remote_wakeup_pending = false;
+    LEDs_SetAllLEDs(LEDMASK_USB_SUSPENDED);
+}
+
+/** Event handler for the library USB Wake Up event. */
+void EVENT_USB_Device_WakeUp(void)
+{
+    usb_suspended = false;
+    remote_wakeup_pending = false;
+    LEDs_SetAllLEDs(USB_DeviceState == DEVICE_STATE_Configured ?
+                    LEDMASK_USB_READY : LEDMASK_USB_ENUMERATING);
+}
+
 /** Event handler for the library USB Configuration Changed event. */
 void EVENT_USB_Device_ConfigurationChanged(void)
 {
     bool ConfigSuccess = true;
 
+    /* Feature reports return to their defaults when the device is configured */
+    wheel_high_resolution = false;
+
     ConfigSuccess &= HID_Device_ConfigureEndpoints(&Mouse_HID_Interface);
+#ifdef ENABLE_KEYBOARD
+    ConfigSuccess &= HID_Device_ConfigureEndpoints(&Keyboard_HID_Interface);
+    key_pressed = false;
+#endif
 #ifdef ENABLE_VIRTUAL_SERIAL
     ConfigSuccess &= CDC_Device_ConfigureEndpoints(&VirtualSerial_CDC_Interface);
 #endif
@@ -240,12 +488,19 @@ void EVENT_USB_Device_ControlRequest(void)
     CDC_Device_ProcessControlRequest(&VirtualSerial_CDC_Interface);
 #endif
     HID_Device_ProcessControlRequest(&Mouse_HID_Interface);
+#ifdef ENABLE_KEYBOARD
+    HID_Device_ProcessControlRequest(&Keyboard_HID_Interface);
+#endif
 }
 
 /** Event handler for the USB device Start Of Frame event. */
 void EVENT_USB_Device_StartOfFrame(void)
 {
     HID_Device_MillisecondElapsed(&Mouse_HID_Interface);
+#ifdef ENABLE_KEYBOARD
+    HID_Device_MillisecondElapsed(&Keyboard_HID_Interface);
+#endif
+    captureBlockerEnd();
 }
 
 /** HID class driver callback function for the creation of HID reports to the host.
@@ -267,15 +522,39 @@ bool CALLBACK_HID_Device_CreateHIDReport(USB_ClassInfo_HID_Device_t* const
         void* ReportData,
         uint16_t* const ReportSize)
 {
-    *(Mouse_Report*)ReportData = mouse_report_data;
-    *ReportSize = sizeof(Mouse_Report);
+#ifdef ENABLE_KEYBOARD
+    if (HIDInterfaceInfo == &Keyboard_HID_Interface) {
+        *ReportSize = sizeof(USB_KeyboardReport_Data_t);
+        return createKeyboardReport((USB_KeyboardReport_Data_t*)ReportData);
+    }
+#endif
 
-    if (needs_update) {
-        needs_update = false;
-        return true;
+    if (ReportType == HID_REPORT_ITEM_Feature) {
+        if (*ReportID == REPORT_ID_Settings) {
+            memcpy(ReportData, &adapter_settings, sizeof(AdapterSettings));
+            *ReportSize = SETTINGS_REPORT_SIZE;
+        }
+        else if (*ReportID == REPORT_ID_SettingsCommand) {
+            *(uint8_t*)ReportData = getSettingsCommandStatus();
+            *ReportSize = 1;
+        }
+        else if (*ReportID == REPORT_ID_ResolutionMultiplier) {
+            *(uint8_t*)ReportData = wheel_high_resolution;
+            *ReportSize = 1;
+        }
+        else if (*ReportID == REPORT_ID_Status) {
+            AdapterStatus status;
+            memset(ReportData, 0, STATUS_REPORT_SIZE);
+            getAdapterStatus(&status);
+            memcpy(ReportData, &status, sizeof(AdapterStatus));
+            *ReportSize = STATUS_REPORT_SIZE;
+        }
+
+        return false;
     }
 
-    return false;
+    return createMouseInterfaceReport(!HIDInterfaceInfo->State.UsingReportProtocol, ReportID,
+                                      ReportData, ReportSize);
 }
 
 /** HID class driver callback function for the processing of HID reports from the host.
@@ -293,7 +572,27 @@ void CALLBACK_HID_Device_ProcessHIDReport(USB_ClassInfo_HID_Device_t* const
         const void* ReportData,
         const uint16_t ReportSize)
 {
-    // Unused (but mandatory for the HID class driver) in this demo, since there are no Host->Device reports
+#ifdef ENABLE_KEYBOARD
+    if (HIDInterfaceInfo == &Keyboard_HID_Interface) {
+        // keyboard LEDs are not used
+        return;
+    }
+#endif
+
+    if (ReportType == HID_REPORT_ITEM_Feature && ReportID == REPORT_ID_Settings &&
+            ReportSize >= sizeof(AdapterSettings)) {
+        AdapterSettings new_settings;
+        memcpy(&new_settings, ReportData, sizeof(new_settings));
+        applySettings(&new_settings);
+    }
+    else if (ReportType == HID_REPORT_ITEM_Feature && ReportID == REPORT_ID_SettingsCommand &&
+             ReportSize >= 1) {
+        requestSettingsCommand(*(const uint8_t*)ReportData);
+    }
+    else if (ReportType == HID_REPORT_ITEM_Feature && ReportID == REPORT_ID_ResolutionMultiplier &&
+             ReportSize >= 1) {
+        wheel_high_resolution = *(const uint8_t*)ReportData & 0x01;
+    }
 }
 
 #ifdef ENABLE_VIRTUAL_SERIAL
@@ -314,6 +613,14 @@ void EVENT_CDC_Device_ControLineStateChanged(USB_ClassInfo_CDC_Device_t* const
     bool HostReady = (CDCInterfaceInfo->State.ControlLineStates.HostToDevice &
                       CDC_CONTROL_LINE_OUT_DTR) != 0;
 
+#ifdef ENABLE_CAPTURE_TRACE
+    /* A new trace, with its header, starts each time the port is opened */
+    trace_host_ready = HostReady;
+    if (!HostReady) {
+        trace_started = false;
+    }
+#else
     (void)HostReady;
+#endif
 }
 #endif
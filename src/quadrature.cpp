@@ -0,0 +1,165 @@
+/*  Quadrature mouse decoding. See quadrature.hpp.
+
+    The decoder runs entirely in the line interrupts, which only sample the
+    lines and do one table lookup, so edge rates far above what a ball
+    mouse produces (a few kHz) are decoded without missed transitions as
+    long as no other interrupt blocks for longer than one edge period.
+*/
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <util/atomic.h>
+
+#include "board.hpp"
+#include "controller.hpp"
+#include "quadrature.hpp"
+
+
+namespace c1351_mouse {
+
+static_assert(isPin<Board::UpBtn2, PortD, 1>() && isPin<Board::Down, PortB, 1>() &&
+              isPin<Board::Left, PortB, 4>(),
+              "DB9 pins 1-3 must be on INT1, PCINT1 and PCINT4");
+
+/* Amiga: H/HQ is X, V/VQ is Y */
+constexpr QuadratureAxis AMIGA_X = {QUAD_LINE_2, QUAD_LINE_4};
+constexpr QuadratureAxis AMIGA_Y = {QUAD_LINE_1, QUAD_LINE_3};
+/* Atari ST: XA/XB is X, YA/YB is Y */
+constexpr QuadratureAxis ATARI_X = {QUAD_LINE_2, QUAD_LINE_1};
+constexpr QuadratureAxis ATARI_Y = {QUAD_LINE_3, QUAD_LINE_4};
+
+static_assert(isHalfAxis(AMIGA_X) != isHalfAxis(AMIGA_Y) &&
+              isHalfAxis(ATARI_X) != isHalfAxis(ATARI_Y),
+              "exactly one axis may use the line without interrupt");
+
+constexpr QuadratureTable AMIGA_TABLE = makeQuadratureTable(AMIGA_X, AMIGA_Y);
+constexpr QuadratureTable ATARI_TABLE = makeQuadratureTable(ATARI_X, ATARI_Y);
+
+static const QuadratureTable amiga_table PROGMEM = AMIGA_TABLE;
+static const QuadratureTable atari_table PROGMEM = ATARI_TABLE;
+
+
+static C1351_IO io_pin;
+
+static const QuadratureTable* table = &amiga_table;
+static bool half_axis_x = true;  // else the Y axis is decoded at 2x
+
+static volatile uint8_t last_lines = 0;
+static volatile int16_t countX = 0;
+static volatile int16_t countY = 0;
+static volatile uint16_t errors = 0;
+
+
+/* INT1 (DB9 pin 1), any edge */
+ISR(INT1_vect)
+{
+    uint8_t lines = readDirectionLines();
+    uint8_t step = pgm_read_byte(&table->step[last_lines << 4 | lines]);
+    last_lines = lines;
+
+    if (step & QUAD_X_INC) {
+        countX++;
+    }
+    else if (step & QUAD_X_DEC) {
+        countX--;
+    }
+
+    if (step & QUAD_Y_INC) {
+        countY++;
+    }
+    else if (step & QUAD_Y_DEC) {
+        countY--;
+    }
+
+    if (step & QUAD_ERROR) {
+        errors++;
+    }
+}
+
+
+/* PCINT1 (DB9 pin 2) and PCINT4 (DB9 pin 3) */
+ISR(PCINT0_vect, ISR_ALIASOF(INT1_vect));
+
+
+void initQuadrature(uint8_t input_mode)
+{
+    stopQuadrature();
+
+    if (input_mode == INPUT_MODE_ATARI_ST) {
+        table = &atari_table;
+        half_axis_x = isHalfAxis(ATARI_X);
+    }
+    else {
+        table = &amiga_table;
+        half_axis_x = isHalfAxis(AMIGA_X);
+    }
+
+    io_pin.up_btn2.setDirectionIn(true);
+    io_pin.down.setDirectionIn(true);
+    io_pin.left.setDirectionIn(true);
+    io_pin.right.setDirectionIn(true);
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        last_lines = readDirectionLines();
+        countX = 0;
+        countY = 0;
+        errors = 0;
+
+        // INT1 on any edge
+        EICRA = (EICRA & ~(_BV(ISC11) | _BV(ISC10))) | _BV(ISC10);
+        EIFR = _BV(INTF1);
+        EIMSK |= _BV(INT1);
+
+        PCMSK0 |= _BV(PCINT1) | _BV(PCINT4);
+        PCIFR = _BV(PCIF0);
+        PCICR |= _BV(PCIE0);
+    }
+}
+
+
+void stopQuadrature()
+{
+    EIMSK &= ~_BV(INT1);
+    PCICR &= ~_BV(PCIE0);
+    PCMSK0 &= ~(_BV(PCINT1) | _BV(PCINT4));
+}
+
+
+void takeQuadratureCounts(int16_t& x, int16_t& y)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        x = countX;
+        y = countY;
+        countX = 0;
+        countY = 0;
+    }
+
+    // 2x steps are half a 4x cycle
+    if (half_axis_x) {
+        x *= 2;
+    }
+    else {
+        y *= 2;
+    }
+}
+
+
+uint8_t getQuadratureStep(uint8_t input_mode, uint8_t prev_lines, uint8_t lines)
+{
+    const QuadratureTable* t = input_mode == INPUT_MODE_ATARI_ST ? &atari_table : &amiga_table;
+    return pgm_read_byte(&t->step[prev_lines << 4 | lines]);
+}
+
+
+uint16_t getQuadratureErrors()
+{
+    uint16_t count;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        count = errors;
+    }
+
+    return count;
+}
+
+}
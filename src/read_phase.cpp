@@ -0,0 +1,93 @@
+#include "read_phase.hpp"
+#include "settings.h"
+
+
+namespace c1351_mouse {
+
+void ReadPhaseTuner::update(bool answered, uint16_t latest_edge_us)
+{
+    const uint8_t margin = adapter_settings.ReadPhaseMargin;
+
+    if (!margin) {
+        readUs = READ_PHASE_TIMEOUT_US;
+        restartWindow();
+        return;
+    }
+
+    if (!answered) {
+        if (readUs < READ_PHASE_TIMEOUT_US) {
+            if (missedEdges < 0xffff) {
+                missedEdges++;
+            }
+            // a read phase thought to be stable was too short, measure again
+            if (stableReadUs <= readUs) {
+                stableReadUs = 0;
+            }
+        }
+        readUs = READ_PHASE_TIMEOUT_US;
+        restartWindow();
+        return;
+    }
+
+    // the cycle ran with the current read phase
+    if (readUs > windowReadUs) {
+        windowReadUs = readUs;
+    }
+    if (latest_edge_us > windowEdgeUs) {
+        windowEdgeUs = latest_edge_us;
+    }
+
+    uint16_t needed = limit(latest_edge_us + margin);
+    if (needed > readUs) {
+        readUs = needed;
+    }
+
+    if (++windowCycles < READ_PHASE_WINDOW) {
+        return;
+    }
+
+    // a whole window without a missing edge
+    if (!stableReadUs || windowReadUs < stableReadUs) {
+        stableReadUs = windowReadUs;
+    }
+    latestEdgeUs = windowEdgeUs;
+    readUs = limit(windowEdgeUs + margin);
+    restartWindow();
+}
+
+
+uint16_t ReadPhaseTuner::getReadUs() const
+{
+    return readUs;
+}
+
+
+void ReadPhaseTuner::getStatus(AdapterStatus& status) const
+{
+    status.ReadPhaseUs = readUs;
+    status.LatestEdgeUs = latestEdgeUs;
+    status.StableReadPhaseUs = stableReadUs;
+    status.MissedEdges = missedEdges;
+}
+
+
+void ReadPhaseTuner::restartWindow()
+{
+    windowEdgeUs = 0;
+    windowReadUs = 0;
+    windowCycles = 0;
+}
+
+
+uint16_t ReadPhaseTuner::limit(uint16_t read_us)
+{
+    if (read_us < READ_PHASE_MIN_US) {
+        return READ_PHASE_MIN_US;
+    }
+    if (read_us > READ_PHASE_TIMEOUT_US) {
+        return READ_PHASE_TIMEOUT_US;
+    }
+    return read_us;
+}
+
+}
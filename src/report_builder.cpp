@@ -0,0 +1,69 @@
+#include "report_builder.hpp"
+#include "reports.h"
+#include "settings.h"
+#ifdef ENABLE_KEYBOARD
+#include "mouse.h"
+#endif
+
+
+namespace c1351_mouse {
+
+#ifdef ENABLE_KEYBOARD
+/* Send the keystrokes bound to the middle button and to flicks. Takes the
+ * bound middle button and the gesture movement out of the mouse report.
+ */
+void MouseReportBuilder::sendKeyBindings(MouseVelocity& x, MouseVelocity& y, uint8_t& pressed)
+{
+    KeyBinding middle = adapter_settings.KeyBindings[KEY_BINDING_MIDDLE];
+    bool middle_pressed = pressed & (1 << BUTTON_INDEX_MIDDLE);
+
+    if (middle.KeyCode) {
+        if (middle_pressed && !middleWasPressed) {
+            queueKeyStroke(middle.Modifier, middle.KeyCode);
+        }
+        pressed &= ~(1 << BUTTON_INDEX_MIDDLE);
+    }
+    middleWasPressed = middle_pressed;
+
+    uint8_t flick = gesture.update(x, y, pressed);
+
+    if (flick != GESTURE_NONE) {
+        KeyBinding binding = adapter_settings.KeyBindings[flick];
+        if (binding.KeyCode) {
+            queueKeyStroke(binding.Modifier, binding.KeyCode);
+        }
+    }
+}
+#endif
+
+
+void MouseReportBuilder::update(MouseVelocity x, MouseVelocity y, bool left, bool right,
+                                uint8_t wheel_multiplier, uint32_t interval_us)
+{
+    uint8_t pressed = 0;
+    uint8_t buttons = 0;
+
+    if (left) {
+        pressed |= 1 << BUTTON_INDEX_LEFT;
+    }
+
+    if (right) {
+        pressed |= 1 << BUTTON_INDEX_RIGHT;
+    }
+
+    middleButton.update(pressed, interval_us);
+#ifdef ENABLE_KEYBOARD
+    sendKeyBindings(x, y, pressed);
+#endif
+    int8_t wheel = scroll.update(x, y, pressed, wheel_multiplier);
+
+    for (uint8_t i = 0; i < BUTTON_INDEX_COUNT; i++) {
+        if (pressed & (1 << i)) {
+            buttons |= adapter_settings.ButtonMap[i];
+        }
+    }
+
+    setUsbMouse(x, y, wheel, buttons);
+}
+
+}
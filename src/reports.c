@@ -0,0 +1,155 @@
+/*  Contents of the IN reports of the mouse interface. See reports.h.
+
+    The report values are written from the main interrupt, and read by the
+    HID class driver from the USB task that it calls.
+*/
+
+#include "reports.h"
+
+
+static volatile Mouse_Report mouse_report_data;
+static volatile bool needs_update = true;
+static volatile Gamepad_Report gamepad_report_data;
+static volatile bool gamepad_needs_update = false;
+static volatile Tablet_Report tablet_report_data;
+static volatile bool tablet_needs_update = false;
+/* Mouse movement not sent yet in boot protocol, beyond the int8_t range of
+   the boot report */
+static int16_t boot_remainder_x = 0;
+static int16_t boot_remainder_y = 0;
+
+
+void initMouseReportData(void)
+{
+    setUsbMouse(0, 0, 0, 0);
+    setUsbGamepad(0, 0, 0);
+    setUsbTablet(0, 0, 0);
+    needs_update = true;
+    gamepad_needs_update = false;
+    tablet_needs_update = false;
+    boot_remainder_x = 0;
+    boot_remainder_y = 0;
+}
+
+
+void setUsbMouse(int16_t x, int16_t y, int8_t wheel, uint8_t button)
+{
+    if (x || x != mouse_report_data.X) {
+        mouse_report_data.X = x;
+        needs_update = true;
+    }
+
+    if (y || y != mouse_report_data.Y) {
+        mouse_report_data.Y = y;
+        needs_update = true;
+    }
+
+    if (wheel || wheel != mouse_report_data.Wheel) {
+        mouse_report_data.Wheel = wheel;
+        needs_update = true;
+    }
+
+    if (button != mouse_report_data.Button) {
+        mouse_report_data.Button = button;
+        needs_update = true;
+    }
+}
+
+
+void setUsbGamepad(int16_t x, int16_t y, uint8_t button)
+{
+    if (x != gamepad_report_data.X || y != gamepad_report_data.Y ||
+            button != gamepad_report_data.Button) {
+        gamepad_report_data.X = x;
+        gamepad_report_data.Y = y;
+        gamepad_report_data.Button = button;
+        gamepad_needs_update = true;
+    }
+}
+
+
+void setUsbTablet(uint16_t x, uint16_t y, uint8_t button)
+{
+    if (x != tablet_report_data.X || y != tablet_report_data.Y ||
+            button != tablet_report_data.Button) {
+        tablet_report_data.X = x;
+        tablet_report_data.Y = y;
+        tablet_report_data.Button = button;
+        tablet_needs_update = true;
+    }
+}
+
+
+/* Clamp a mouse axis to the int8_t range of the boot protocol report */
+static int8_t clampBootAxis(int16_t value)
+{
+    return value > 127 ? 127 : value < -127 ? -127 : value;
+}
+
+
+/* Add movement to a boot protocol remainder, within the int16_t range */
+static int16_t addBootRemainder(int16_t remainder, int16_t value)
+{
+    int32_t sum = (int32_t)remainder + value;
+
+    return sum > 32767 ? 32767 : sum < -32767 ? -32767 : sum;
+}
+
+
+bool createMouseInterfaceReport(bool boot_protocol, uint8_t* report_id, void* report_data,
+                                uint16_t* report_size)
+{
+    /* In boot protocol (BIOS setup screens, KVM switches), the host expects
+       the standard 3-byte mouse report without a report ID, built from the
+       current mouse report. Movement beyond its int8_t range is sent with
+       the following reports. Gamepad and tablet reports are held back. */
+    if (boot_protocol) {
+        Boot_Mouse_Report* boot_report = (Boot_Mouse_Report*)report_data;
+        bool send = needs_update || boot_remainder_x || boot_remainder_y;
+
+        if (needs_update) {
+            needs_update = false;
+            boot_remainder_x = addBootRemainder(boot_remainder_x, mouse_report_data.X);
+            boot_remainder_y = addBootRemainder(boot_remainder_y, mouse_report_data.Y);
+        }
+
+        *report_id = 0;
+        boot_report->Button = mouse_report_data.Button & 0x07;
+        boot_report->X = clampBootAxis(boot_remainder_x);
+        boot_report->Y = clampBootAxis(boot_remainder_y);
+        boot_remainder_x -= boot_report->X;
+        boot_remainder_y -= boot_report->Y;
+        *report_size = sizeof(Boot_Mouse_Report);
+        return send;
+    }
+
+    boot_remainder_x = 0;
+    boot_remainder_y = 0;
+
+    if (gamepad_needs_update) {
+        gamepad_needs_update = false;
+        *report_id = REPORT_ID_Gamepad;
+        *(Gamepad_Report*)report_data = gamepad_report_data;
+        *report_size = sizeof(Gamepad_Report);
+        return true;
+    }
+
+    if (tablet_needs_update) {
+        tablet_needs_update = false;
+        *report_id = REPORT_ID_Tablet;
+        *(Tablet_Report*)report_data = tablet_report_data;
+        *report_size = sizeof(Tablet_Report);
+        return true;
+    }
+
+    *report_id = REPORT_ID_Mouse;
+    *(Mouse_Report*)report_data = mouse_report_data;
+    *report_size = sizeof(Mouse_Report);
+
+    if (needs_update) {
+        needs_update = false;
+        return true;
+    }
+
+    return false;
+}
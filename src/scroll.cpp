@@ -0,0 +1,102 @@
+#include <stdlib.h>
+
+#include "scroll.hpp"
+#include "settings.h"
+
+
+namespace c1351_mouse {
+
+enum {
+    SCROLL_IDLE = 0,
+    SCROLL_PENDING,      // scroll buttons pressed, not moved yet
+    SCROLL_ACTIVE,       // scrolling until the buttons are released
+    SCROLL_PASSTHROUGH,  // part of a chord used as normal buttons
+};
+
+
+int8_t ScrollEmulator::update(int16_t& x, int16_t& y, uint8_t& buttons, uint8_t multiplier)
+{
+    const uint8_t mask = adapter_settings.ScrollButtons;
+    uint8_t trigger = buttons & mask;
+    int8_t wheel = 0;
+
+    if (state == SCROLL_IDLE && trigger) {
+        state = SCROLL_PENDING;
+        heldButtons = 0;
+        distance = 0;
+    }
+
+    switch (state) {
+    case SCROLL_PENDING:
+        heldButtons |= trigger;
+        if (!trigger) {
+            // released without moving: send the withheld click, which is
+            // released with the next report
+            buttons |= heldButtons;
+            state = SCROLL_IDLE;
+            break;
+        }
+
+        distance += abs(x) + abs(y);
+        if (distance < SCROLL_START_DISTANCE) {
+            x = 0;
+            y = 0;
+            buttons &= ~mask;
+        }
+        else if (trigger == mask) {
+            remainder = 0;
+            state = SCROLL_ACTIVE;
+            wheel = scroll(y, multiplier);
+            x = 0;
+            y = 0;
+            buttons &= ~mask;
+        }
+        else {
+            state = SCROLL_PASSTHROUGH;
+        }
+        break;
+
+    case SCROLL_ACTIVE:
+        if (!trigger) {
+            state = SCROLL_IDLE;
+            break;
+        }
+        wheel = scroll(y, multiplier);
+        x = 0;
+        y = 0;
+        buttons &= ~mask;
+        break;
+
+    case SCROLL_PASSTHROUGH:
+        if (!trigger) {
+            state = SCROLL_IDLE;
+        }
+        break;
+    }
+
+    return wheel;
+}
+
+
+/* Convert Y movement to wheel movement, keeping the remainder for the next
+ * report. Moving the mouse up scrolls up.
+ */
+int8_t ScrollEmulator::scroll(int16_t y, uint8_t multiplier)
+{
+    const uint8_t divisor = adapter_settings.ScrollDivisor;
+    int32_t total = remainder - (int32_t)y * multiplier;
+    int32_t wheel = total / divisor;
+
+    if (wheel > 127 || wheel < -127) {
+        // too fast for one report, drop the excess
+        wheel = wheel > 0 ? 127 : -127;
+        remainder = 0;
+    }
+    else {
+        remainder = total - wheel * divisor;
+    }
+
+    return wheel;
+}
+
+}
@@ -0,0 +1,79 @@
+/*  Runtime adapter settings. See settings.h.
+
+    Settings are changed from USB control requests, which are processed
+    from handleUsb() inside the main interrupt, so the sampling code never
+    sees a partially written struct. Code running outside the main interrupt
+    (see settings_store.c) must apply settings with interrupts disabled.
+*/
+
+#include <string.h>
+
+#include "settings.h"
+
+
+#define DEFAULT_SCALE_DIVISOR (F_CPU / 1000000)
+#define DEFAULT_REPORT_INTERVAL 40
+#define DEFAULT_JOYSTICK_RAMP 4
+#define DEFAULT_JOYSTICK_MAX_SPEED 16
+#define DEFAULT_PADDLE_RANGE 256
+#define DEFAULT_PADDLE_AVERAGE_SHIFT 2
+#define DEFAULT_SCROLL_BUTTONS (1 << BUTTON_INDEX_RIGHT)
+#define DEFAULT_SCROLL_DIVISOR 32
+#define DEFAULT_CHORD_WINDOW 50
+
+
+AdapterSettings adapter_settings;
+
+
+void resetSettings(void)
+{
+    memset(&adapter_settings, 0, sizeof(adapter_settings));
+
+    adapter_settings.Version = SETTINGS_VERSION;
+    adapter_settings.ScaleDivisor = DEFAULT_SCALE_DIVISOR;
+    adapter_settings.FilterShift = 0;
+    adapter_settings.SpikeLimit = 0;
+    adapter_settings.ReportInterval = DEFAULT_REPORT_INTERVAL;
+    adapter_settings.ButtonMap[BUTTON_INDEX_LEFT] = 1 << 0;
+    adapter_settings.ButtonMap[BUTTON_INDEX_RIGHT] = 1 << 1;
+    adapter_settings.ButtonMap[BUTTON_INDEX_MIDDLE] = 1 << 2;
+    adapter_settings.PotOffsetX = 0;
+    adapter_settings.PotOffsetY = 0;
+    adapter_settings.AccelProfile = ACCEL_PROFILE_FLAT;
+    adapter_settings.InputMode = INPUT_MODE_AUTO;
+    adapter_settings.JoystickOutput = JOYSTICK_OUTPUT_GAMEPAD;
+    adapter_settings.JoystickRamp = DEFAULT_JOYSTICK_RAMP;
+    adapter_settings.JoystickMaxSpeed = DEFAULT_JOYSTICK_MAX_SPEED;
+    adapter_settings.PaddleRange = DEFAULT_PADDLE_RANGE;
+    adapter_settings.PaddleAverageShift = DEFAULT_PADDLE_AVERAGE_SHIFT;
+    adapter_settings.ScrollButtons = DEFAULT_SCROLL_BUTTONS;
+    adapter_settings.ScrollDivisor = DEFAULT_SCROLL_DIVISOR;
+    adapter_settings.ChordWindow = DEFAULT_CHORD_WINDOW;
+    adapter_settings.GestureButtons = 0;
+    // KeyBindings are all unbound
+    adapter_settings.ReadPhaseMargin = 0;
+}
+
+
+bool applySettings(const AdapterSettings* settings)
+{
+    if (settings->Version != SETTINGS_VERSION ||
+            settings->ScaleDivisor == 0 ||
+            settings->FilterShift > SETTINGS_MAX_FILTER_SHIFT ||
+            settings->ReportInterval == 0 ||
+            settings->AccelProfile >= ACCEL_PROFILE_COUNT ||
+            settings->InputMode >= INPUT_MODE_COUNT ||
+            settings->JoystickOutput >= JOYSTICK_OUTPUT_COUNT ||
+            settings->JoystickRamp == 0 ||
+            settings->PaddleRange == 0 ||
+            settings->PaddleRange > SETTINGS_MAX_PADDLE_RANGE ||
+            settings->PaddleAverageShift > SETTINGS_MAX_PADDLE_AVERAGE_SHIFT ||
+            settings->ScrollButtons >= (1 << BUTTON_INDEX_COUNT) ||
+            settings->ScrollDivisor == 0 ||
+            settings->GestureButtons >= (1 << BUTTON_INDEX_COUNT)) {
+        return false;
+    }
+
+    adapter_settings = *settings;
+    return true;
+}
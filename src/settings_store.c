@@ -0,0 +1,185 @@
+/*  EEPROM storage of the adapter settings. See settings_store.h.
+
+    Each slot holds one SettingsRecord. The sequence number of an erased slot
+    reads as 0xffff, which is never written. Since slots are written in
+    order, all valid sequence numbers lie within SETTINGS_SLOTS of each
+    other, and the newest record is found with wrapping comparisons.
+*/
+
+#include <avr/eeprom.h>
+#include <stddef.h>
+#include <string.h>
+#include <util/atomic.h>
+#include <util/crc16.h>
+
+#include "settings_store.h"
+
+
+#define SEQUENCE_EMPTY 0xffff
+
+typedef struct {
+    uint16_t Sequence;
+    uint8_t Data[SETTINGS_REPORT_SIZE];  // AdapterSettings, zero-padded
+    uint16_t Crc;
+} SettingsRecord;
+
+#define SETTINGS_SLOTS ((E2END + 1) / sizeof(SettingsRecord))
+
+
+static SettingsRecord EEMEM settings_slots[SETTINGS_SLOTS];
+
+/* Slot and sequence number of the record that was last loaded or written.
+ * current_slot is SETTINGS_SLOTS if there is none.
+ */
+static uint8_t current_slot = SETTINGS_SLOTS;
+static uint16_t current_sequence = 0;
+
+static volatile uint8_t pending_command = SETTINGS_COMMAND_NONE;
+static volatile uint8_t running_command = SETTINGS_COMMAND_NONE;
+
+
+static uint16_t recordCrc(const SettingsRecord* record)
+{
+    const uint8_t* bytes = (const uint8_t*)record;
+    uint16_t crc = 0xffff;
+
+    for (uint8_t i = 0; i < offsetof(SettingsRecord, Crc); i++) {
+        crc = _crc_ccitt_update(crc, bytes[i]);
+    }
+
+    return crc;
+}
+
+
+/* Returns true if sequence number a is newer than b */
+static bool sequenceNewer(uint16_t a, uint16_t b)
+{
+    return (int16_t)(a - b) > 0;
+}
+
+
+/* Find the newest valid record and apply it. Only the sequence numbers are
+ * read up front; full records are read, newest first, until one passes the
+ * CRC and version checks.
+ */
+static bool loadNewestRecord(void)
+{
+    uint16_t sequences[SETTINGS_SLOTS];
+    SettingsRecord record;
+
+    for (uint8_t slot = 0; slot < SETTINGS_SLOTS; slot++) {
+        sequences[slot] = eeprom_read_word(&settings_slots[slot].Sequence);
+    }
+
+    for (;;) {
+        uint8_t newest = SETTINGS_SLOTS;
+
+        for (uint8_t slot = 0; slot < SETTINGS_SLOTS; slot++) {
+            if (sequences[slot] != SEQUENCE_EMPTY &&
+                    (newest == SETTINGS_SLOTS ||
+                     sequenceNewer(sequences[slot], sequences[newest]))) {
+                newest = slot;
+            }
+        }
+
+        if (newest == SETTINGS_SLOTS) {
+            return false;
+        }
+
+        eeprom_read_block(&record, &settings_slots[newest], sizeof(record));
+
+        if (record.Crc == recordCrc(&record)) {
+            bool applied;
+
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                applied = applySettings((const AdapterSettings*)record.Data);
+            }
+
+            if (applied) {
+                current_slot = newest;
+                current_sequence = record.Sequence;
+                return true;
+            }
+        }
+
+        sequences[newest] = SEQUENCE_EMPTY;  // invalid, try the next newest
+    }
+}
+
+
+/* Write the current settings to the slot after the current one. */
+static void commitSettings(void)
+{
+    SettingsRecord record;
+    uint8_t slot = current_slot + 1;
+
+    if (slot >= SETTINGS_SLOTS) {
+        slot = 0;
+    }
+
+    record.Sequence = current_sequence + 1;
+    if (record.Sequence == SEQUENCE_EMPTY) {
+        record.Sequence = 0;
+    }
+
+    memset(record.Data, 0, sizeof(record.Data));
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        memcpy(record.Data, &adapter_settings, sizeof(AdapterSettings));
+    }
+    record.Crc = recordCrc(&record);
+
+    eeprom_update_block(&record, &settings_slots[slot], sizeof(record));
+
+    current_slot = slot;
+    current_sequence = record.Sequence;
+}
+
+
+void loadSettings(void)
+{
+    resetSettings();
+    loadNewestRecord();
+}
+
+
+void requestSettingsCommand(uint8_t command)
+{
+    if (command == SETTINGS_COMMAND_DEFAULTS) {
+        resetSettings();
+    }
+    else if (command == SETTINGS_COMMAND_COMMIT || command == SETTINGS_COMMAND_LOAD) {
+        pending_command = command;
+    }
+}
+
+
+uint8_t getSettingsCommandStatus(void)
+{
+    uint8_t command = pending_command;
+    return command != SETTINGS_COMMAND_NONE ? command : running_command;
+}
+
+
+void handleSettingsCommand(void)
+{
+    uint8_t command;
+
+    if (pending_command == SETTINGS_COMMAND_NONE) {
+        return;
+    }
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        command = pending_command;
+        pending_command = SETTINGS_COMMAND_NONE;
+        running_command = command;
+    }
+
+    if (command == SETTINGS_COMMAND_COMMIT) {
+        commitSettings();
+    }
+    else if (command == SETTINGS_COMMAND_LOAD) {
+        loadNewestRecord();
+    }
+
+    running_command = SETTINGS_COMMAND_NONE;
+}
@@ -0,0 +1,312 @@
+/*  c1351ctl - read and change C1351 USB Adapter settings at runtime
+
+    Talks to the adapter's vendor-defined settings feature report through the
+    Linux hidraw interface. The report contents are an AdapterSettings struct
+    (see include/settings.h).
+
+    Usage:
+        c1351ctl [-d /dev/hidrawN] [name=value ...] [commit|load|defaults]
+        c1351ctl [-d /dev/hidrawN] status
+
+    Without arguments the current settings are printed. Assignments are
+    applied by reading, modifying and writing back the settings in one
+    feature report. They only last until the adapter is unplugged, unless
+    followed by "commit", which saves the settings to EEPROM. "load" reverts
+    to the saved settings and "defaults" to the built-in defaults.
+    Without -d, the first hidraw device with the adapter's VID/PID is used.
+
+    "status" prints the measurements of the status feature report (see
+    include/status.h) instead.
+*/
+
+#include <fcntl.h>
+#include <linux/hidraw.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+#include "settings.h"
+#include "settings_fields.hpp"
+#include "status.h"
+
+
+namespace {
+
+// must match VENDOR_ID, PRODUCT_ID and REPORT_ID_* in descriptors.h
+const uint16_t ADAPTER_VENDOR_ID = 0x03eb;
+const uint16_t ADAPTER_PRODUCT_ID = 0x2041;
+const uint8_t REPORT_ID_SETTINGS = 2;
+const uint8_t REPORT_ID_SETTINGS_COMMAND = 3;
+const uint8_t REPORT_ID_STATUS = 7;
+
+
+struct Command {
+    const char* name;
+    uint8_t command;
+};
+
+const Command COMMANDS[] = {
+    {"commit", SETTINGS_COMMAND_COMMIT},
+    {"load", SETTINGS_COMMAND_LOAD},
+    {"defaults", SETTINGS_COMMAND_DEFAULTS},
+};
+
+
+void usage()
+{
+    fprintf(stderr, "usage: c1351ctl [-d /dev/hidrawN] [name=value ...] "
+            "[commit|load|defaults]\n"
+            "       c1351ctl [-d /dev/hidrawN] status\n\nsettings:\n");
+    for (const auto& field : FIELDS) {
+        fprintf(stderr, "  %-10s %s\n", field.name, field.help);
+    }
+}
+
+
+bool isAdapter(int fd)
+{
+    hidraw_devinfo info;
+    if (ioctl(fd, HIDIOCGRAWINFO, &info) < 0) {
+        return false;
+    }
+    return (uint16_t)info.vendor == ADAPTER_VENDOR_ID &&
+           (uint16_t)info.product == ADAPTER_PRODUCT_ID;
+}
+
+
+int openAdapter(const char* path)
+{
+    if (path) {
+        int fd = open(path, O_RDWR);
+        if (fd < 0) {
+            perror(path);
+        }
+        return fd;
+    }
+
+    for (int i = 0; i < 64; i++) {
+        std::string dev = "/dev/hidraw" + std::to_string(i);
+        int fd = open(dev.c_str(), O_RDWR);
+        if (fd < 0) {
+            continue;
+        }
+        if (isAdapter(fd)) {
+            return fd;
+        }
+        close(fd);
+    }
+
+    fprintf(stderr, "no C1351 adapter found (check permissions on /dev/hidraw*)\n");
+    return -1;
+}
+
+
+bool readSettings(int fd, AdapterSettings& settings)
+{
+    uint8_t buf[1 + SETTINGS_REPORT_SIZE] = {REPORT_ID_SETTINGS};
+
+    if (ioctl(fd, HIDIOCGFEATURE(sizeof(buf)), buf) < 0) {
+        perror("HIDIOCGFEATURE");
+        return false;
+    }
+
+    memcpy(&settings, buf + 1, sizeof(settings));
+    if (settings.Version != SETTINGS_VERSION) {
+        fprintf(stderr, "unsupported settings version %u (expected %u)\n",
+                settings.Version, SETTINGS_VERSION);
+        return false;
+    }
+    return true;
+}
+
+
+bool writeSettings(int fd, const AdapterSettings& settings)
+{
+    uint8_t buf[1 + SETTINGS_REPORT_SIZE] = {REPORT_ID_SETTINGS};
+    memcpy(buf + 1, &settings, sizeof(settings));
+
+    if (ioctl(fd, HIDIOCSFEATURE(sizeof(buf)), buf) < 0) {
+        perror("HIDIOCSFEATURE");
+        return false;
+    }
+    return true;
+}
+
+
+/* Send a SETTINGS_COMMAND_* and wait until the adapter has run it. */
+bool runCommand(int fd, uint8_t command)
+{
+    uint8_t buf[2] = {REPORT_ID_SETTINGS_COMMAND, command};
+
+    if (ioctl(fd, HIDIOCSFEATURE(sizeof(buf)), buf) < 0) {
+        perror("HIDIOCSFEATURE");
+        return false;
+    }
+
+    // an EEPROM commit takes about 3.4 ms per changed byte
+    for (int i = 0; i < 100; i++) {
+        buf[0] = REPORT_ID_SETTINGS_COMMAND;
+        if (ioctl(fd, HIDIOCGFEATURE(sizeof(buf)), buf) < 0) {
+            perror("HIDIOCGFEATURE");
+            return false;
+        }
+        if (buf[1] == SETTINGS_COMMAND_NONE) {
+            return true;
+        }
+        const timespec delay = {0, 20 * 1000 * 1000};
+        nanosleep(&delay, nullptr);
+    }
+
+    fprintf(stderr, "timeout waiting for adapter\n");
+    return false;
+}
+
+
+bool readStatus(int fd, AdapterStatus& status)
+{
+    uint8_t buf[1 + STATUS_REPORT_SIZE] = {REPORT_ID_STATUS};
+
+    if (ioctl(fd, HIDIOCGFEATURE(sizeof(buf)), buf) < 0) {
+        perror("HIDIOCGFEATURE");
+        return false;
+    }
+
+    memcpy(&status, buf + 1, sizeof(status));
+    return true;
+}
+
+
+/* Read cycles per second with the given read phase */
+unsigned cycleRate(const AdapterStatus& status, uint16_t read_us)
+{
+    return 1000000 / (status.SyncPhaseUs + read_us);
+}
+
+
+void printStatus(const AdapterStatus& status)
+{
+    printf("sync phase: %u uS\n", status.SyncPhaseUs);
+    printf("read phase: %u uS (%u read cycles/s)\n", status.ReadPhaseUs,
+           cycleRate(status, status.ReadPhaseUs));
+    printf("latest edge: %u uS\n", status.LatestEdgeUs);
+    if (status.StableReadPhaseUs) {
+        printf("stable read phase: %u uS (%u read cycles/s)\n", status.StableReadPhaseUs,
+               cycleRate(status, status.StableReadPhaseUs));
+    }
+    else {
+        printf("stable read phase: not measured yet\n");
+    }
+    printf("missed edges: %u\n", status.MissedEdges);
+    printf("quadrature errors: %u\n", status.QuadratureErrors);
+}
+
+
+void printSettings(const AdapterSettings& settings)
+{
+    for (const auto& field : FIELDS) {
+        printf("%s=%ld\n", field.name, getField(settings, field));
+    }
+}
+
+
+const Command* findCommand(const char* arg)
+{
+    for (const auto& command : COMMANDS) {
+        if (!strcmp(arg, command.name)) {
+            return &command;
+        }
+    }
+    return nullptr;
+}
+
+
+/* Run the command line from argument first_arg on the opened adapter.
+ * Returns the exit code.
+ */
+int run(int fd, int first_arg, int argc, char** argv)
+{
+    if (first_arg == argc - 1 && !strcmp(argv[first_arg], "status")) {
+        AdapterStatus status;
+        if (!readStatus(fd, status)) {
+            return 1;
+        }
+        printStatus(status);
+        return 0;
+    }
+
+    AdapterSettings settings;
+    if (!readSettings(fd, settings)) {
+        return 1;
+    }
+
+    if (first_arg == argc) {
+        printSettings(settings);
+        return 0;
+    }
+
+    // assignments first, then an optional trailing command
+    const Command* command = findCommand(argv[argc - 1]);
+    int last_assignment = command ? argc - 1 : argc;
+
+    for (int i = first_arg; i < last_assignment; i++) {
+        if (!assign(settings, argv[i])) {
+            usage();
+            return 1;
+        }
+    }
+
+    AdapterSettings applied = settings;
+
+    if (last_assignment > first_arg) {
+        if (!writeSettings(fd, settings) || !readSettings(fd, applied)) {
+            return 1;
+        }
+        // the adapter silently rejects out-of-range settings
+        if (memcmp(&applied, &settings, sizeof(settings)) != 0) {
+            fprintf(stderr, "adapter rejected the new settings\n");
+            return 1;
+        }
+    }
+
+    if (command) {
+        if (!runCommand(fd, command->command) || !readSettings(fd, applied)) {
+            return 1;
+        }
+    }
+
+    printSettings(applied);
+    return 0;
+}
+
+}
+
+
+int main(int argc, char** argv)
+{
+    const char* path = nullptr;
+    int first_arg = 1;
+
+    if (argc > 1 && (!strcmp(argv[1], "-h") || !strcmp(argv[1], "--help"))) {
+        usage();
+        return 0;
+    }
+    if (argc > 2 && !strcmp(argv[1], "-d")) {
+        path = argv[2];
+        first_arg = 3;
+    }
+
+    int fd = openAdapter(path);
+    if (fd < 0) {
+        return 1;
+    }
+
+    int result = run(fd, first_arg, argc, argv);
+    close(fd);
+    return result;
+}
@@ -0,0 +1,226 @@
+/*  c1351fuzz - libFuzzer harness for the C1351 capture to report path
+
+    Runs arbitrary capture sequences through the host build of the C1351
+    processing (see host/pipeline.hpp) and of the report code of the adapter
+    (report_builder.hpp and reports.h), with settings taken
+    from the input, and aborts when an invariant does not hold:
+
+    - Reported movement stays within what the captures can produce: at most
+      half the position range of the C1351 per read cycle, times the
+      largest acceleration gain, over ScaleDivisor, and never beyond the
+      report's logical range. The wheel stays within -127 to 127, and only
+      mapped buttons are sent.
+    - Without acceleration, filtering and the spike limit, the movement of
+      each report is exactly the movement of its captures, computed here
+      without the firmware's 16-bit wrap arithmetic.
+    - No undefined behavior: the harness is built with the address and
+      undefined behavior sanitizers, which abort on the first error.
+
+    Input: SETTINGS_BYTES bytes that select the settings (see
+    applyFuzzSettings()), then FUZZ_CYCLE_BYTES per read cycle: the POTX
+    and POTY timestamps, little-endian, and a byte of TRACE_FLAG_* bits and
+    FUZZ_FLAG_HIGH_RESOLUTION.
+
+    Build with "make fuzz" (needs clang), then run:
+        build/fuzz/c1351fuzz [corpus directory]
+*/
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#include "acceleration.hpp"
+#include "pipeline.hpp"
+#include "report_builder.hpp"
+#include "reports.h"
+#include "settings.h"
+#include "trace.hpp"
+
+
+using namespace c1351_mouse;
+
+
+namespace {
+
+const size_t SETTINGS_BYTES = 8;
+const size_t FUZZ_CYCLE_BYTES = 5;
+// the host has high-resolution scrolling on, for the report of this cycle
+const uint8_t FUZZ_FLAG_HIGH_RESOLUTION = 0x10;
+
+const int32_t AXIS_LIMIT = 32767;
+const int32_t WHEEL_LIMIT = 127;
+// see C1351Interface::potValueToVelocity()
+const int32_t POT_WRAP = 128 * (F_CPU / 1000000);
+
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "c1351fuzz: %s failed at line %d\n", #condition, __LINE__); \
+            abort(); \
+        } \
+    } while (0)
+
+
+/* Settings from the first bytes of the input. Out-of-range values are
+ * folded into range, so that every input runs.
+ */
+bool applyFuzzSettings(const uint8_t* data)
+{
+    resetSettings();
+    AdapterSettings settings = adapter_settings;
+
+    settings.ScaleDivisor = data[0] ? data[0] : 1;
+    settings.FilterShift = data[1] % (SETTINGS_MAX_FILTER_SHIFT + 1);
+    settings.SpikeLimit = data[2];
+    settings.ReportInterval = data[3] ? data[3] : 1;
+    settings.AccelProfile = data[4] % ACCEL_PROFILE_COUNT;
+    settings.ScrollButtons = data[5] % (1 << BUTTON_INDEX_COUNT);
+    settings.ScrollDivisor = data[6] ? data[6] : 1;
+    settings.ChordWindow = data[7];
+
+    return applySettings(&settings);
+}
+
+
+/* Movement between two captures, in capture timer ticks, as the C1351
+ * position wraps
+ */
+int32_t wrappedDelta(uint16_t previous, uint16_t current)
+{
+    int32_t delta = ((int32_t)current - previous) % POT_WRAP;
+
+    if (delta < 0) {
+        delta += POT_WRAP;
+    }
+    return delta >= POT_WRAP / 2 ? delta - POT_WRAP : delta;
+}
+
+
+int32_t clampAxis(int32_t value)
+{
+    return value > AXIS_LIMIT ? AXIS_LIMIT : value < -AXIS_LIMIT ? -AXIS_LIMIT : value;
+}
+
+
+/* Reference model of the movement, for settings without acceleration,
+ * filtering and spike limit
+ */
+struct ReferenceModel {
+    bool haveLast = false;
+    uint16_t lastX = 0;
+    uint16_t lastY = 0;
+    int32_t accumX = 0;
+    int32_t accumY = 0;
+
+    void addCycle(const CaptureCycle& cycle)
+    {
+        // a read cycle is only used if both axes answered
+        if (!cycle.xCaptured || !cycle.yCaptured) {
+            haveLast = false;
+            return;
+        }
+        if (haveLast) {
+            accumX += wrappedDelta(lastX, cycle.potX);
+            accumY -= wrappedDelta(lastY, cycle.potY);
+        }
+        lastX = cycle.potX;
+        lastY = cycle.potY;
+        haveLast = true;
+    }
+
+    void takeReport(int32_t& x, int32_t& y)
+    {
+        x = clampAxis(accumX / adapter_settings.ScaleDivisor);
+        y = clampAxis(accumY / adapter_settings.ScaleDivisor);
+        accumX = 0;
+        accumY = 0;
+    }
+};
+
+
+void checkBounds(const MouseSample& sample, const Mouse_Report& report)
+{
+    const int32_t max_per_cycle = (POT_WRAP / 2) * ACCEL_MAX_GAIN / ACCEL_GAIN_ONE;
+    int32_t bound = (int32_t)adapter_settings.ReportInterval * max_per_cycle /
+                    adapter_settings.ScaleDivisor;
+    if (bound > AXIS_LIMIT) {
+        bound = AXIS_LIMIT;
+    }
+
+    CHECK(abs(sample.x) <= bound && abs(sample.y) <= bound);
+    CHECK(abs(report.X) <= bound && abs(report.Y) <= bound);
+    CHECK(abs(report.Wheel) <= WHEEL_LIMIT);
+
+    uint8_t mapped = 0;
+    for (uint8_t i = 0; i < BUTTON_INDEX_COUNT; i++) {
+        mapped |= adapter_settings.ButtonMap[i];
+    }
+    CHECK((report.Button & ~mapped) == 0);
+
+    // without scroll buttons, the movement is reported as is
+    if (!adapter_settings.ScrollButtons) {
+        CHECK(report.X == sample.x && report.Y == sample.y && report.Wheel == 0);
+    }
+}
+
+}
+
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    if (size < SETTINGS_BYTES || !applyFuzzSettings(data)) {
+        return 0;
+    }
+    data += SETTINGS_BYTES;
+    size -= SETTINGS_BYTES;
+
+    const bool exact = adapter_settings.AccelProfile == ACCEL_PROFILE_FLAT &&
+                       adapter_settings.FilterShift == 0 &&
+                       adapter_settings.SpikeLimit == 0;
+
+    HostPipeline pipeline;
+    MouseReportBuilder builder;
+    ReferenceModel reference;
+    MouseSample sample;
+    Mouse_Report report = {};
+
+    initMouseReportData();
+    for (; size >= FUZZ_CYCLE_BYTES; data += FUZZ_CYCLE_BYTES, size -= FUZZ_CYCLE_BYTES) {
+        CaptureCycle cycle;
+        cycle.potX = data[0] | data[1] << 8;
+        cycle.potY = data[2] | data[3] << 8;
+        cycle.xCaptured = data[4] & TRACE_FLAG_X_CAPTURED;
+        cycle.yCaptured = data[4] & TRACE_FLAG_Y_CAPTURED;
+        cycle.left = data[4] & TRACE_FLAG_LEFT;
+        cycle.right = data[4] & TRACE_FLAG_RIGHT;
+
+        reference.addCycle(cycle);
+        if (!pipeline.runCycle(cycle, sample)) {
+            continue;
+        }
+
+        // the host can switch to high-resolution scrolling at any time
+        const uint8_t wheel_multiplier = data[4] & FUZZ_FLAG_HIGH_RESOLUTION ?
+                                         WHEEL_RESOLUTION_MULTIPLIER : 1;
+        builder.update(sample.x, sample.y, sample.left, sample.right, wheel_multiplier,
+                       adapter_settings.ReportInterval * (uint32_t)TRACE_DEFAULT_CYCLE_US);
+
+        // the mouse report is written even when it is not sent
+        uint8_t report_id;
+        uint16_t report_size;
+        if (createMouseInterfaceReport(false, &report_id, &report, &report_size)) {
+            CHECK(report_id == REPORT_ID_Mouse && report_size == sizeof(Mouse_Report));
+        }
+        checkBounds(sample, report);
+
+        int32_t expected_x;
+        int32_t expected_y;
+        reference.takeReport(expected_x, expected_y);
+        if (exact) {
+            CHECK(sample.x == expected_x && sample.y == expected_y);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,208 @@
+/*  c1351gen - synthetic C1351 motion workloads
+
+    Generates the captures of a C1351 moving along one of the workloads in
+    motion.cpp, as a trace for c1351replay, or runs the whole workload suite
+    through the adapter's C1351 processing code as a benchmark.
+
+    Usage:
+        c1351gen list
+        c1351gen [-s seed] [-c cycles] workload trace.c1t
+        c1351gen [-s seed] [-n repeat] bench [name=value ...]
+
+    -s selects the random seed (default 1); the same seed always gives the
+    same captures. -c overrides the length of the workload in read cycles.
+    The benchmark prints, for each workload, the movement the mouse made
+    and the movement the adapter reported, both in mouse counts, and the
+    processing time per read cycle. Settings are the defaults, changed by
+    the assignments, which take the same names as c1351ctl.
+*/
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "motion.hpp"
+#include "pipeline.hpp"
+#include "settings.h"
+#include "settings_fields.hpp"
+#include "trace.hpp"
+
+
+using namespace c1351_mouse;
+
+
+namespace {
+
+const uint8_t CPU_TICKS_PER_US = F_CPU / 1000000;
+const uint16_t CYCLE_US = TRACE_DEFAULT_CYCLE_US;
+
+
+void usage()
+{
+    fprintf(stderr, "usage: c1351gen list\n"
+            "       c1351gen [-s seed] [-c cycles] workload trace.c1t\n"
+            "       c1351gen [-s seed] [-n repeat] bench [name=value ...]\n");
+}
+
+
+void listWorkloads()
+{
+    for (size_t i = 0; i < WORKLOAD_COUNT; i++) {
+        printf("%-14s %s\n", WORKLOADS[i].name, WORKLOADS[i].description);
+    }
+}
+
+
+bool writeWorkload(const Workload& workload, uint64_t seed, uint32_t cycles,
+                   const char* path)
+{
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        perror(path);
+        return false;
+    }
+
+    TraceHeader header;
+    header.ticksPerUs = CPU_TICKS_PER_US;
+    header.cycleUs = CYCLE_US;
+    header.settings = adapter_settings;
+
+    MotionGenerator generator(workload, workloadSeed(seed, workload));
+    bool ok = writeTraceHeader(file, header);
+    for (uint32_t i = 0; ok && i < cycles; i++) {
+        ok = writeTraceRecord(file, toTraceRecord(generator.next()));
+    }
+
+    if (fclose(file) != 0 || !ok) {
+        perror(path);
+        return false;
+    }
+    return true;
+}
+
+
+/* Movement of a number of C1351 steps in mouse counts, without
+ * acceleration and filtering
+ */
+double stepsToCounts(int32_t steps)
+{
+    return (double)steps * STEP_US * CPU_TICKS_PER_US / adapter_settings.ScaleDivisor;
+}
+
+
+void benchmark(uint64_t seed, long repeat)
+{
+    printf("%-14s %8s %10s %10s %10s %10s %9s %10s\n", "workload", "cycles",
+           "mouse x", "mouse y", "report x", "report y", "ns/cycle", "realtime");
+
+    for (size_t w = 0; w < WORKLOAD_COUNT; w++) {
+        const Workload& workload = WORKLOADS[w];
+        std::chrono::duration<double> elapsed(0);
+        int64_t total_x = 0;
+        int64_t total_y = 0;
+        int32_t steps_x = 0;
+        int32_t steps_y = 0;
+
+        for (long r = 0; r < repeat; r++) {
+            MotionGenerator generator(workload, workloadSeed(seed, workload));
+            CaptureCycle* cycles = new CaptureCycle[workload.cycles];
+            for (uint32_t i = 0; i < workload.cycles; i++) {
+                cycles[i] = generator.next();
+            }
+
+            // only the processing is timed
+            auto start = std::chrono::steady_clock::now();
+            HostPipeline pipeline;
+            MouseSample sample;
+            total_x = 0;
+            total_y = 0;
+            for (uint32_t i = 0; i < workload.cycles; i++) {
+                if (pipeline.runCycle(cycles[i], sample)) {
+                    total_x += sample.x;
+                    total_y += sample.y;
+                }
+            }
+            elapsed += std::chrono::steady_clock::now() - start;
+
+            steps_x = generator.getStepsX();
+            steps_y = generator.getStepsY();
+            delete[] cycles;
+        }
+
+        double cycles = (double)workload.cycles * repeat;
+        double ns = elapsed.count() * 1e9 / cycles;
+        // Y is reported inverted, see C1351Interface::accumulateVelocities()
+        printf("%-14s %8u %10.0f %10.0f %10lld %10lld %9.1f %9.0fx\n", workload.name,
+               workload.cycles, stepsToCounts(steps_x), stepsToCounts(-steps_y),
+               (long long)total_x, (long long)total_y, ns, CYCLE_US * 1000.0 / ns);
+    }
+}
+
+}
+
+
+int main(int argc, char** argv)
+{
+    uint64_t seed = 1;
+    long cycles = 0;
+    long repeat = 1;
+    int arg = 1;
+
+    for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+        long value = strtol(argv[arg + 1], nullptr, 0);
+        if (!strcmp(argv[arg], "-s")) {
+            seed = value;
+        }
+        else if (!strcmp(argv[arg], "-c") && value > 0) {
+            cycles = value;
+        }
+        else if (!strcmp(argv[arg], "-n") && value > 0) {
+            repeat = value;
+        }
+        else {
+            usage();
+            return 1;
+        }
+    }
+    if (arg >= argc) {
+        usage();
+        return 1;
+    }
+
+    resetSettings();
+
+    if (!strcmp(argv[arg], "list") && arg + 1 == argc) {
+        listWorkloads();
+        return 0;
+    }
+
+    if (!strcmp(argv[arg], "bench")) {
+        AdapterSettings settings = adapter_settings;
+        for (arg++; arg < argc; arg++) {
+            if (!assign(settings, argv[arg])) {
+                usage();
+                return 1;
+            }
+        }
+        if (!applySettings(&settings)) {
+            fprintf(stderr, "invalid settings\n");
+            return 1;
+        }
+        benchmark(seed, repeat);
+        return 0;
+    }
+
+    const Workload* workload = findWorkload(argv[arg]);
+    if (!workload || arg + 2 != argc) {
+        if (!workload) {
+            fprintf(stderr, "unknown workload '%s', see c1351gen list\n", argv[arg]);
+        }
+        usage();
+        return 1;
+    }
+
+    return writeWorkload(*workload, seed, cycles ? cycles : workload->cycles,
+                         argv[arg + 1]) ? 0 : 1;
+}
@@ -0,0 +1,125 @@
+/*  c1351record - record a C1351 capture trace from the adapter
+
+    Opens the virtual serial port of the trace build of the firmware
+    ("pio run -e trace", see capture_trace.h), which starts a new trace,
+    and writes the header and the records to a trace file for c1351replay.
+    Stops after the given number of read cycles, or on Ctrl-C.
+
+    Usage:
+        c1351record [-c cycles] /dev/ttyACM0 trace.c1t
+
+    The summary on stderr shows the recorded and the skipped read cycles.
+    Skipped cycles were taken while the trace queue of the adapter was full,
+    because its records could not be sent over USB in time. c1351replay
+    replays them as unknown cycles.
+*/
+
+#include <fcntl.h>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "trace.hpp"
+
+
+namespace {
+
+volatile sig_atomic_t interrupted = 0;
+
+
+void usage()
+{
+    fprintf(stderr, "usage: c1351record [-c cycles] /dev/ttyACM0 trace.c1t\n");
+}
+
+
+void onInterrupt(int)
+{
+    interrupted = 1;
+}
+
+
+/* Open the serial port in raw mode. Opening it raises DTR, which makes the
+ * adapter start the trace.
+ */
+FILE* openPort(const char* path)
+{
+    int fd = open(path, O_RDONLY | O_NOCTTY);
+    termios tio;
+
+    if (fd < 0) {
+        perror(path);
+        return nullptr;
+    }
+    if (tcgetattr(fd, &tio) != 0) {
+        perror(path);
+        close(fd);
+        return nullptr;
+    }
+    cfmakeraw(&tio);
+    tcsetattr(fd, TCSANOW, &tio);
+    tcflush(fd, TCIFLUSH);
+    return fdopen(fd, "rb");
+}
+
+}
+
+
+int main(int argc, char** argv)
+{
+    long cycles = 0;
+    int arg = 1;
+
+    if (arg + 1 < argc && !strcmp(argv[arg], "-c")) {
+        cycles = strtol(argv[arg + 1], nullptr, 0);
+        arg += 2;
+    }
+    if (arg + 2 != argc || cycles < 0) {
+        usage();
+        return 1;
+    }
+
+    FILE* port = openPort(argv[arg]);
+    if (!port) {
+        return 1;
+    }
+    FILE* out = fopen(argv[arg + 1], "wb");
+    if (!out) {
+        perror(argv[arg + 1]);
+        return 1;
+    }
+
+    struct sigaction action = {};
+    action.sa_handler = onInterrupt;
+    sigaction(SIGINT, &action, nullptr);
+
+    TraceHeader header;
+    if (!readTraceHeader(port, header) || !writeTraceHeader(out, header)) {
+        return 1;
+    }
+    fprintf(stderr, "recording, %u uS per read cycle, Ctrl-C to stop\n", header.cycleUs);
+
+    long recorded = 0;
+    long skipped = 0;
+    TraceRecord record;
+    while (!interrupted && (!cycles || recorded < cycles) && readTraceRecord(port, record)) {
+        if (!writeTraceRecord(out, record)) {
+            perror(argv[arg + 1]);
+            return 1;
+        }
+        recorded++;
+        skipped += record.skipped;
+    }
+
+    fclose(port);
+    if (fclose(out) != 0) {
+        perror(argv[arg + 1]);
+        return 1;
+    }
+    fprintf(stderr, "%ld read cycles recorded, %ld skipped\n", recorded, skipped);
+    return 0;
+}
@@ -0,0 +1,154 @@
+/*  c1351replay - run a C1351 capture trace through the adapter's processing
+
+    Feeds each read cycle of a trace (see trace.hpp) through the unmodified
+    C1351Interface code, compiled for the host (see host/pipeline.hpp), and
+    prints the mouse state after every update(), one line per USB report:
+
+        <time in uS> <x> <y> <left> <right>
+
+    Usage:
+        c1351replay [-q] [-n repeat] [name=value ...] trace.c1t
+
+    The settings recorded in the trace are used, changed by the
+    assignments, which take the same names as c1351ctl. -q prints only the
+    summary. -n runs the trace the given number of times, for benchmarking.
+    The summary on stderr shows the total movement and how much faster than
+    real time the trace ran.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "pipeline.hpp"
+#include "settings.h"
+#include "settings_fields.hpp"
+#include "trace.hpp"
+
+
+using namespace c1351_mouse;
+
+
+namespace {
+
+void usage()
+{
+    fprintf(stderr, "usage: c1351replay [-q] [-n repeat] [name=value ...] trace.c1t\n\n"
+            "settings:\n");
+    for (const auto& field : FIELDS) {
+        fprintf(stderr, "  %-10s %s\n", field.name, field.help);
+    }
+}
+
+
+struct ReplayResult {
+    uint64_t cycles = 0;
+    uint64_t unknown = 0;
+    uint64_t reports = 0;
+    int64_t totalX = 0;
+    int64_t totalY = 0;
+};
+
+
+/* Run the trace from reset */
+ReplayResult replay(const TraceHeader& header, const std::vector<CaptureCycle>& cycles,
+                    bool print)
+{
+    HostPipeline pipeline;
+    MouseSample sample;
+    ReplayResult result;
+
+    for (const auto& cycle : cycles) {
+        bool reported = pipeline.runCycle(cycle, sample);
+
+        result.cycles++;
+        result.unknown += cycle.unknown;
+        if (!reported) {
+            continue;
+        }
+        result.reports++;
+        result.totalX += sample.x;
+        result.totalY += sample.y;
+        if (print) {
+            printf("%llu %d %d %d %d\n",
+                   (unsigned long long)(result.cycles * header.cycleUs),
+                   sample.x, sample.y, sample.left, sample.right);
+        }
+    }
+
+    return result;
+}
+
+}
+
+
+int main(int argc, char** argv)
+{
+    bool quiet = false;
+    long repeat = 1;
+    int arg = 1;
+
+    for (; arg < argc && argv[arg][0] == '-'; arg++) {
+        if (!strcmp(argv[arg], "-q")) {
+            quiet = true;
+        }
+        else if (!strcmp(argv[arg], "-n") && arg + 1 < argc) {
+            repeat = strtol(argv[++arg], nullptr, 0);
+        }
+        else {
+            usage();
+            return !strcmp(argv[arg], "-h") || !strcmp(argv[arg], "--help") ? 0 : 1;
+        }
+    }
+    if (arg >= argc || repeat < 1) {
+        usage();
+        return 1;
+    }
+
+    const char* path = argv[argc - 1];
+    TraceHeader header;
+    std::vector<CaptureCycle> cycles;
+    if (!loadTrace(path, header, cycles)) {
+        return 1;
+    }
+
+    AdapterSettings settings = header.settings;
+    if (settings.Version != SETTINGS_VERSION) {
+        fprintf(stderr, "trace settings are version %u, using the defaults\n",
+                settings.Version);
+        resetSettings();
+        settings = adapter_settings;
+    }
+    for (; arg < argc - 1; arg++) {
+        if (!assign(settings, argv[arg])) {
+            usage();
+            return 1;
+        }
+    }
+    if (!applySettings(&settings)) {
+        fprintf(stderr, "invalid settings\n");
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    ReplayResult result;
+    for (long i = 0; i < repeat; i++) {
+        result = replay(header, cycles, !quiet && i == 0);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    double trace_s = result.cycles * header.cycleUs * 1e-6;
+    fprintf(stderr, "%llu read cycles (%.3f s), %llu reports, total x %lld y %lld\n",
+            (unsigned long long)result.cycles, trace_s,
+            (unsigned long long)result.reports, (long long)result.totalX,
+            (long long)result.totalY);
+    if (result.unknown) {
+        fprintf(stderr, "%llu read cycles not recorded, replayed as unknown\n",
+                (unsigned long long)result.unknown);
+    }
+    fprintf(stderr, "replayed %ld time(s) in %.3f s, %.0fx real time\n", repeat,
+            elapsed.count(), elapsed.count() > 0 ? trace_s * repeat / elapsed.count() : 0);
+    return 0;
+}
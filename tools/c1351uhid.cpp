@@ -0,0 +1,525 @@
+/*  c1351uhid - the adapter as a virtual USB mouse on Linux
+
+    Creates a HID device through /dev/uhid with the adapter's report
+    descriptor (MouseReport in descriptors.c, built for the host), and sends
+    the mouse reports of a capture trace or a synthetic workload (see
+    c1351gen) in real time, one read cycle every 512 uS, as the adapter
+    would. The reports go through the host build of the C1351 processing
+    (see host/pipeline.hpp) and of the report code of the adapter
+    (report_builder.hpp and reports.h). The settings and status feature
+    reports work as on the adapter, so c1351ctl can read and change the
+    settings of the virtual adapter while it runs.
+
+    Usage:
+        c1351uhid [-b] [-s seed] [-c cycles] [name=value ...] trace.c1t|workload
+
+    -s and -c select the seed and length of a workload, as with c1351gen.
+    With -b, the evdev device of the virtual mouse is opened, and the time
+    from writing each report to /dev/uhid until the timestamp of its input
+    events is measured and summarized at the end.
+
+    Needs write access to /dev/uhid, and with -b read access to
+    /dev/input/event*, so usually root.
+*/
+
+#include <fcntl.h>
+#include <linux/input.h>
+#include <linux/uhid.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include "motion.hpp"
+#include "pipeline.hpp"
+#include "report_builder.hpp"
+#include "reports.h"
+#include "settings.h"
+#include "settings_fields.hpp"
+#include "status.h"
+#include "trace.hpp"
+
+
+using namespace c1351_mouse;
+
+
+// the report descriptor of descriptors.c, see the mouse_report.c rule in
+// the Makefile
+extern "C" const uint8_t MouseReport[];
+extern "C" const uint16_t MouseReportSize;
+
+
+namespace {
+
+const char DEVICE_NAME[] = "C1351 Mouse Adapter (virtual)";
+const uint16_t CYCLE_US = TRACE_DEFAULT_CYCLE_US;
+// longest wait for the kernel to start the device and for an input event
+const int START_TIMEOUT_MS = 2000;
+const int EVENT_TIMEOUT_MS = 100;
+
+
+void usage()
+{
+    fprintf(stderr, "usage: c1351uhid [-b] [-s seed] [-c cycles] [name=value ...] "
+            "trace.c1t|workload\n");
+}
+
+
+int64_t nowNs()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+
+/* The virtual device, and the adapter state the host can see */
+struct VirtualAdapter {
+    int uhid = -1;
+    int evdev = -1;
+    bool started = false;
+    bool opened = false;
+    uint8_t wheelMultiplier = 1;
+};
+
+
+bool writeEvent(int fd, const uhid_event& event)
+{
+    if (write(fd, &event, sizeof(event)) != (ssize_t)sizeof(event)) {
+        perror("/dev/uhid");
+        return false;
+    }
+    return true;
+}
+
+
+bool createDevice(VirtualAdapter& adapter)
+{
+    adapter.uhid = open("/dev/uhid", O_RDWR | O_CLOEXEC);
+    if (adapter.uhid < 0) {
+        perror("/dev/uhid");
+        return false;
+    }
+
+    uhid_event event = {};
+    event.type = UHID_CREATE2;
+    snprintf((char*)event.u.create2.name, sizeof(event.u.create2.name), "%s", DEVICE_NAME);
+    event.u.create2.rd_size = MouseReportSize;
+    memcpy(event.u.create2.rd_data, MouseReport, MouseReportSize);
+    event.u.create2.bus = BUS_USB;
+    event.u.create2.vendor = VENDOR_ID;
+    event.u.create2.product = PRODUCT_ID;
+    return writeEvent(adapter.uhid, event);
+}
+
+
+/* Answer a GET_REPORT request like mouse.c does. data starts with the
+ * report ID.
+ */
+void getReport(VirtualAdapter& adapter, const uhid_get_report_req& request)
+{
+    uhid_event reply = {};
+    uint8_t* data = reply.u.get_report_reply.data;
+
+    reply.type = UHID_GET_REPORT_REPLY;
+    reply.u.get_report_reply.id = request.id;
+    data[0] = request.rnum;
+
+    if (request.rnum == REPORT_ID_Settings) {
+        memcpy(data + 1, &adapter_settings, sizeof(adapter_settings));
+        reply.u.get_report_reply.size = 1 + SETTINGS_REPORT_SIZE;
+    }
+    else if (request.rnum == REPORT_ID_SettingsCommand) {
+        // commands finish at once
+        data[1] = SETTINGS_COMMAND_NONE;
+        reply.u.get_report_reply.size = 2;
+    }
+    else if (request.rnum == REPORT_ID_ResolutionMultiplier) {
+        data[1] = adapter.wheelMultiplier != 1;
+        reply.u.get_report_reply.size = 2;
+    }
+    else if (request.rnum == REPORT_ID_Status) {
+        AdapterStatus status = {};
+        status.SyncPhaseUs = CYCLE_US / 2;
+        status.ReadPhaseUs = CYCLE_US / 2;
+        memcpy(data + 1, &status, sizeof(status));
+        reply.u.get_report_reply.size = 1 + STATUS_REPORT_SIZE;
+    }
+    else {
+        reply.u.get_report_reply.err = EIO;
+    }
+
+    writeEvent(adapter.uhid, reply);
+}
+
+
+/* Answer a SET_REPORT request. There is no EEPROM, so the settings can
+ * only be reset to the defaults.
+ */
+void setReport(VirtualAdapter& adapter, const uhid_set_report_req& request)
+{
+    uhid_event reply = {};
+    const uint8_t* data = request.data;
+
+    reply.type = UHID_SET_REPORT_REPLY;
+    reply.u.set_report_reply.id = request.id;
+
+    if (request.rnum == REPORT_ID_Settings && request.size >= 1 + sizeof(AdapterSettings)) {
+        AdapterSettings settings;
+        memcpy(&settings, data + 1, sizeof(settings));
+        if (!applySettings(&settings)) {
+            reply.u.set_report_reply.err = EINVAL;
+        }
+    }
+    else if (request.rnum == REPORT_ID_SettingsCommand && request.size >= 2) {
+        if (data[1] == SETTINGS_COMMAND_DEFAULTS) {
+            resetSettings();
+        }
+    }
+    else if (request.rnum == REPORT_ID_ResolutionMultiplier && request.size >= 2) {
+        adapter.wheelMultiplier = data[1] ? WHEEL_RESOLUTION_MULTIPLIER : 1;
+    }
+    else {
+        reply.u.set_report_reply.err = EIO;
+    }
+
+    writeEvent(adapter.uhid, reply);
+}
+
+
+bool handleUhidEvent(VirtualAdapter& adapter)
+{
+    uhid_event event;
+
+    if (read(adapter.uhid, &event, sizeof(event)) <= 0) {
+        perror("/dev/uhid");
+        return false;
+    }
+
+    switch (event.type) {
+    case UHID_START:
+        adapter.started = true;
+        break;
+    case UHID_STOP:
+        adapter.started = false;
+        break;
+    case UHID_OPEN:
+        adapter.opened = true;
+        break;
+    case UHID_CLOSE:
+        adapter.opened = false;
+        break;
+    case UHID_GET_REPORT:
+        getReport(adapter, event.u.get_report);
+        break;
+    case UHID_SET_REPORT:
+        setReport(adapter, event.u.set_report);
+        break;
+    }
+    return true;
+}
+
+
+/* Handle requests from the kernel until the deadline. If fd becomes
+ * readable first, returns 1, at the deadline 0, on errors -1.
+ */
+int serveUntil(VirtualAdapter& adapter, int64_t deadline_ns, int fd = -1)
+{
+    pollfd fds[2] = {{adapter.uhid, POLLIN, 0}, {fd, POLLIN, 0}};
+
+    for (;;) {
+        int64_t remaining = deadline_ns - nowNs();
+        if (remaining <= 0) {
+            return 0;
+        }
+
+        timespec timeout = {(time_t)(remaining / 1000000000), (long)(remaining % 1000000000)};
+        int ready = ppoll(fds, fd >= 0 ? 2 : 1, &timeout, nullptr);
+        if (ready < 0 && errno != EINTR) {
+            perror("ppoll");
+            return -1;
+        }
+        if (ready > 0 && (fds[0].revents & POLLIN) && !handleUhidEvent(adapter)) {
+            return -1;
+        }
+        if (ready > 0 && fd >= 0 && (fds[1].revents & POLLIN)) {
+            return 1;
+        }
+    }
+}
+
+
+/* The event device the kernel made for the virtual mouse, opened with
+ * monotonic timestamps
+ */
+int openEventDevice()
+{
+    for (int i = 0; i < 256; i++) {
+        std::string path = "/dev/input/event" + std::to_string(i);
+        int fd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+
+        input_id id;
+        char name[sizeof(DEVICE_NAME)] = {};
+        unsigned long rel_bits = 0;
+        if (ioctl(fd, EVIOCGID, &id) == 0 && id.vendor == VENDOR_ID &&
+                id.product == PRODUCT_ID &&
+                ioctl(fd, EVIOCGNAME(sizeof(name) - 1), name) >= 0 &&
+                !strncmp(name, DEVICE_NAME, sizeof(DEVICE_NAME) - 1) &&
+                ioctl(fd, EVIOCGBIT(EV_REL, sizeof(rel_bits)), &rel_bits) >= 0 &&
+                (rel_bits & (1 << REL_X))) {
+            int clock = CLOCK_MONOTONIC;
+            if (ioctl(fd, EVIOCSCLOCKID, &clock) == 0) {
+                return fd;
+            }
+        }
+        close(fd);
+    }
+    return -1;
+}
+
+
+/* Read the events of one report, until SYN_REPORT. Returns the timestamp
+ * of the SYN_REPORT, or -1 if it did not come in time.
+ */
+int64_t readReportEvents(VirtualAdapter& adapter)
+{
+    int64_t deadline = nowNs() + EVENT_TIMEOUT_MS * 1000000ll;
+
+    for (;;) {
+        input_event event;
+        ssize_t size = read(adapter.evdev, &event, sizeof(event));
+
+        if (size == (ssize_t)sizeof(event)) {
+            if (event.type == EV_SYN && event.code == SYN_REPORT) {
+                return (int64_t)event.input_event_sec * 1000000000 +
+                       (int64_t)event.input_event_usec * 1000;
+            }
+            continue;
+        }
+        if (serveUntil(adapter, deadline, adapter.evdev) != 1) {
+            return -1;
+        }
+    }
+}
+
+
+/* Whether the mouse report makes the input layer send events. Zero
+ * movement and unchanged buttons are dropped by the kernel.
+ */
+bool makesEvents(const Mouse_Report& report, const Mouse_Report& last)
+{
+    return report.X || report.Y || report.Wheel || report.Button != last.Button;
+}
+
+
+/* Take the next report of the mouse interface, as the HID class driver
+ * does on the adapter. Returns false if there is none to send.
+ */
+bool takeReport(uhid_event& event)
+{
+    uint8_t* data = event.u.input2.data;
+    uint16_t size;
+
+    event = {};
+    event.type = UHID_INPUT2;
+    if (!createMouseInterfaceReport(false, &data[0], &data[1], &size)) {
+        return false;
+    }
+    event.u.input2.size = size + 1;
+    return true;
+}
+
+
+void printLatencies(std::vector<int64_t>& latencies, unsigned lost)
+{
+    if (latencies.empty()) {
+        fprintf(stderr, "no input events measured, %u lost\n", lost);
+        return;
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    int64_t sum = 0;
+    for (int64_t latency : latencies) {
+        sum += latency;
+    }
+
+    auto percentile = [&](unsigned p) {
+        return latencies[(latencies.size() - 1) * p / 100] / 1000.0;
+    };
+    fprintf(stderr, "uhid to evdev latency over %zu reports, %u lost (uS):\n",
+            latencies.size(), lost);
+    fprintf(stderr, "  min %.1f  median %.1f  mean %.1f  p99 %.1f  max %.1f\n",
+            latencies.front() / 1000.0, percentile(50),
+            sum / 1000.0 / latencies.size(), percentile(99), latencies.back() / 1000.0);
+}
+
+
+/* Send the reports of the read cycles, paced in real time */
+bool run(VirtualAdapter& adapter, const std::vector<CaptureCycle>& cycles, bool benchmark)
+{
+    HostPipeline pipeline;
+    MouseReportBuilder builder;
+    Mouse_Report last = {};
+    MouseSample sample;
+    uhid_event event;
+    std::vector<int64_t> latencies;
+    unsigned lost = 0;
+    unsigned long reports = 0;
+
+    initMouseReportData();
+    const int64_t start = nowNs();
+    for (size_t i = 0; i < cycles.size(); i++) {
+        if (!pipeline.runCycle(cycles[i], sample)) {
+            continue;
+        }
+
+        builder.update(sample.x, sample.y, sample.left, sample.right, adapter.wheelMultiplier,
+                       adapter_settings.ReportInterval * (uint32_t)CYCLE_US);
+        if (!takeReport(event)) {
+            continue;
+        }
+        if (serveUntil(adapter, start + (int64_t)(i + 1) * CYCLE_US * 1000) < 0) {
+            return false;
+        }
+
+        int64_t sent = nowNs();
+        if (!writeEvent(adapter.uhid, event)) {
+            return false;
+        }
+        reports++;
+
+        // only mouse reports are set on the host
+        Mouse_Report report;
+        memcpy(&report, &event.u.input2.data[1], sizeof(report));
+
+        if (benchmark && makesEvents(report, last)) {
+            int64_t received = readReportEvents(adapter);
+            if (received < 0) {
+                lost++;
+            }
+            else {
+                latencies.push_back(received - sent);
+            }
+        }
+        last = report;
+    }
+
+    fprintf(stderr, "%zu read cycles (%.3f s), %lu reports sent\n", cycles.size(),
+            cycles.size() * CYCLE_US * 1e-6, reports);
+    if (benchmark) {
+        printLatencies(latencies, lost);
+    }
+    return true;
+}
+
+
+/* Read cycles of a trace file or a workload name */
+bool loadCycles(const char* source, uint64_t seed, long cycle_count,
+                std::vector<CaptureCycle>& cycles, AdapterSettings& settings)
+{
+    const Workload* workload = findWorkload(source);
+
+    if (workload) {
+        MotionGenerator generator(*workload, workloadSeed(seed, *workload));
+        uint32_t count = cycle_count ? cycle_count : workload->cycles;
+        for (uint32_t i = 0; i < count; i++) {
+            cycles.push_back(generator.next());
+        }
+        return true;
+    }
+
+    TraceHeader header;
+    if (!loadTrace(source, header, cycles)) {
+        return false;
+    }
+    if (header.settings.Version == SETTINGS_VERSION) {
+        settings = header.settings;
+    }
+    return true;
+}
+
+}
+
+
+int main(int argc, char** argv)
+{
+    bool benchmark = false;
+    uint64_t seed = 1;
+    long cycle_count = 0;
+    int arg = 1;
+
+    for (; arg < argc && argv[arg][0] == '-'; arg++) {
+        if (!strcmp(argv[arg], "-b")) {
+            benchmark = true;
+        }
+        else if (!strcmp(argv[arg], "-s") && arg + 1 < argc) {
+            seed = strtoull(argv[++arg], nullptr, 0);
+        }
+        else if (!strcmp(argv[arg], "-c") && arg + 1 < argc) {
+            cycle_count = strtol(argv[++arg], nullptr, 0);
+        }
+        else {
+            usage();
+            return 1;
+        }
+    }
+    if (arg >= argc || cycle_count < 0) {
+        usage();
+        return 1;
+    }
+
+    resetSettings();
+    AdapterSettings settings = adapter_settings;
+    std::vector<CaptureCycle> cycles;
+    if (!loadCycles(argv[argc - 1], seed, cycle_count, cycles, settings)) {
+        return 1;
+    }
+    for (; arg < argc - 1; arg++) {
+        if (!assign(settings, argv[arg])) {
+            usage();
+            return 1;
+        }
+    }
+    if (!applySettings(&settings)) {
+        fprintf(stderr, "invalid settings\n");
+        return 1;
+    }
+
+    VirtualAdapter adapter;
+    if (!createDevice(adapter)) {
+        return 1;
+    }
+
+    const int64_t start_deadline = nowNs() + START_TIMEOUT_MS * 1000000ll;
+    while (!adapter.started || (benchmark && adapter.evdev < 0)) {
+        if (serveUntil(adapter, std::min(start_deadline, nowNs() + 10000000)) < 0) {
+            return 1;
+        }
+        if (adapter.started && benchmark) {
+            adapter.evdev = openEventDevice();
+        }
+        if (nowNs() >= start_deadline) {
+            fprintf(stderr, adapter.started ? "no event device for the virtual mouse\n" :
+                    "the kernel did not start the virtual mouse\n");
+            return 1;
+        }
+    }
+
+    bool ok = run(adapter, cycles, benchmark);
+
+    uhid_event destroy = {};
+    destroy.type = UHID_DESTROY;
+    writeEvent(adapter.uhid, destroy);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,300 @@
+#!/usr/bin/env python3
+"""footprint - flash and RAM use of the firmware, checked against budgets
+
+Reads firmware.elf of each PlatformIO environment, after "pio run", and
+attributes every function and variable to the object file that defines it.
+Writes the sizes per object and per symbol to footprint.txt in the build
+directory, and checks them against footprint.budget:
+
+    <environment> device <flash> <ram>   usable flash and RAM of the board
+    <environment> total <flash> <ram>    recorded size of the firmware
+    <environment> <object> <flash> <ram> recorded size of an object file
+
+Flash is .text plus the .data initializers, RAM is .data, .bss and .noinit,
+without the stack. The device limits are fixed. The other lines are
+rewritten with the current sizes by -u, so that any growth fails the check
+until the new sizes are recorded (and show up in review). An environment
+without a total line is only checked against its device limits, with a
+warning, until its sizes are recorded.
+
+Usage: footprint.py [-u] [-v] [-b budget] [environment ...]
+    -u  record the current sizes as budgets
+    -v  print the sizes per object
+Without environments, all environments of platformio.ini are checked.
+Exits with 1 if a size exceeds its budget.
+"""
+
+import argparse
+import configparser
+import os
+import re
+import shutil
+import subprocess
+import sys
+
+
+PROJECT_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+BUILD_DIR = os.path.join(PROJECT_DIR, ".pio", "build")
+DEFAULT_BUDGET = os.path.join(PROJECT_DIR, "footprint.budget")
+TOOLCHAIN_DIR = os.path.expanduser("~/.platformio/packages/toolchain-atmelavr/bin")
+
+FLASH_SECTIONS = (".text", ".data")
+RAM_SECTIONS = (".data", ".bss", ".noinit")
+
+# code and data from outside the build directory: avr-libc, libgcc, startup
+OUTSIDE = "(toolchain)"
+# vector table, padding and other bytes not covered by a symbol
+UNNAMED = "(unnamed)"
+TOTAL = "total"
+DEVICE = "device"
+
+# objdump -t: address, flags, section, size, name (after the visibility or
+# version, if any)
+SYMBOL_LINE = re.compile(r"^([0-9a-f]+) (.{7}) (\S+)\s+([0-9a-f]+)\s.*?(\S+)$")
+# objdump -h: index, name, size
+SECTION_LINE = re.compile(r"^\s*\d+ (\S+)\s+([0-9a-f]+) ")
+# PlatformIO builds each library in lib<hash>/, the hash depends on the host
+LIB_DIR = re.compile(r"^lib[0-9a-f]+/")
+# local symbols renamed by link-time optimization
+LTO_SUFFIX = re.compile(r"\.lto_priv\.\d+$")
+
+
+class Size:
+    def __init__(self, flash=0, ram=0):
+        self.flash = flash
+        self.ram = ram
+
+    def add(self, section, size):
+        if section in FLASH_SECTIONS:
+            self.flash += size
+        if section in RAM_SECTIONS:
+            self.ram += size
+
+
+def findObjdump():
+    tool = os.environ.get("AVR_OBJDUMP") or shutil.which("avr-objdump")
+    if not tool and os.path.exists(os.path.join(TOOLCHAIN_DIR, "avr-objdump")):
+        tool = os.path.join(TOOLCHAIN_DIR, "avr-objdump")
+    if not tool:
+        sys.exit("footprint: avr-objdump not found, set AVR_OBJDUMP")
+    return tool
+
+
+def run(objdump, option, path):
+    return subprocess.run([objdump, option, path], check=True,
+                          capture_output=True, text=True).stdout.splitlines()
+
+
+def readSymbols(objdump, path):
+    """Functions and variables of an ELF file, as (name, section, address,
+    size, is_global) tuples
+    """
+    symbols = []
+    for line in run(objdump, "-t", path):
+        match = SYMBOL_LINE.match(line)
+        if not match:
+            continue
+        address, flags, section, size, name = match.groups()
+        size = int(size, 16)
+        # F: function, O: object; skip undefined symbols and labels
+        if not size or ("F" not in flags and "O" not in flags) or section.startswith("*"):
+            continue
+        symbols.append((name, section, address, size, "g" in flags or "w" in flags))
+    return symbols
+
+
+def readSections(objdump, path):
+    sections = {}
+    for line in run(objdump, "-h", path):
+        match = SECTION_LINE.match(line)
+        if match:
+            sections[match.group(1)] = int(match.group(2), 16)
+    return sections
+
+
+def objectName(build_dir, path):
+    return LIB_DIR.sub("", os.path.relpath(path, build_dir).replace(os.sep, "/"))
+
+
+def indexObjects(objdump, build_dir):
+    """Map of (symbol name, is_global) to the objects that define it"""
+    definitions = {}
+    for root, _, files in os.walk(build_dir):
+        for name in sorted(files):
+            if not name.endswith(".o"):
+                continue
+            path = os.path.join(root, name)
+            obj = objectName(build_dir, path)
+            for symbol, _, _, size, is_global in readSymbols(objdump, path):
+                definitions.setdefault((symbol, is_global), []).append((obj, size))
+    return definitions
+
+
+def findObject(definitions, name, size, is_global):
+    candidates = definitions.get((LTO_SUFFIX.sub("", name), is_global))
+    if not candidates:
+        return OUTSIDE
+    # a static symbol may be defined in several objects
+    for obj, obj_size in candidates:
+        if obj_size == size:
+            return obj
+    return candidates[0][0]
+
+
+def measure(objdump, env):
+    """Sizes per object and per symbol of an environment, and the total"""
+    build_dir = os.path.join(BUILD_DIR, env)
+    elf = os.path.join(build_dir, "firmware.elf")
+    if not os.path.exists(elf):
+        sys.exit("footprint: %s not found, run \"pio run -e %s\" first" % (elf, env))
+
+    definitions = indexObjects(objdump, build_dir)
+    objects = {}
+    symbols = []
+    addresses = set()
+    for name, section, address, size, is_global in readSymbols(objdump, elf):
+        # aliases, like the constructor variants of C++, only count once
+        if address in addresses:
+            continue
+        addresses.add(address)
+        obj = findObject(definitions, name, size, is_global)
+        objects.setdefault(obj, Size()).add(section, size)
+        symbols.append((name, section, size, obj))
+
+    total = Size()
+    for section, size in readSections(objdump, elf).items():
+        total.add(section, size)
+
+    named = Size(sum(s.flash for s in objects.values()), sum(s.ram for s in objects.values()))
+    objects[UNNAMED] = Size(total.flash - named.flash, total.ram - named.ram)
+    return total, objects, symbols
+
+
+def writeReport(env, total, objects, symbols):
+    path = os.path.join(BUILD_DIR, env, "footprint.txt")
+    with open(path, "w") as report:
+        report.write("%s: flash %d, RAM %d\n\n" % (env, total.flash, total.ram))
+        report.write("%7s %7s  %s\n" % ("flash", "RAM", "object"))
+        for obj, size in sorted(objects.items(), key=lambda item: -item[1].flash):
+            report.write("%7d %7d  %s\n" % (size.flash, size.ram, obj))
+        report.write("\n%7s %-8s  %-40s %s\n" % ("size", "section", "symbol", "object"))
+        for name, section, size, obj in sorted(symbols, key=lambda s: (-s[2], s[0])):
+            report.write("%7d %-8s  %-40s %s\n" % (size, section, name, obj))
+
+
+def readBudget(path):
+    """Budget lines as {(environment, item): Size}, in file order"""
+    budget = {}
+    if not os.path.exists(path):
+        return budget
+    with open(path) as budget_file:
+        for number, line in enumerate(budget_file, 1):
+            fields = line.split("#", 1)[0].split()
+            if not fields:
+                continue
+            if len(fields) != 4:
+                sys.exit("footprint: %s:%d: expected <environment> <item> <flash> <ram>"
+                         % (path, number))
+            budget[(fields[0], fields[1])] = Size(int(fields[2]), int(fields[3]))
+    return budget
+
+
+def writeBudget(path, budget):
+    header = []
+    if os.path.exists(path):
+        with open(path) as budget_file:
+            header = [line for line in budget_file if line.startswith("#")]
+    with open(path, "w") as budget_file:
+        budget_file.writelines(header)
+        env = None
+        for (item_env, item), size in budget.items():
+            if item_env != env:
+                budget_file.write("\n")
+                env = item_env
+            budget_file.write("%-20s %-50s %6d %5d\n" % (item_env, item, size.flash, size.ram))
+
+
+def check(env, item, size, limit):
+    """Compare the size of an item with its budget. Prints the totals, and
+    the items over budget. Returns False if over.
+    """
+    over = size.flash > limit.flash or size.ram > limit.ram
+    if over or item in (TOTAL, DEVICE):
+        print("%-20s %-50s flash %6d/%-6d RAM %5d/%-5d%s"
+              % (env, item, size.flash, limit.flash, size.ram, limit.ram,
+                 " over budget" if over else ""))
+    return not over
+
+
+def environments():
+    config = configparser.ConfigParser(interpolation=None)
+    config.read(os.path.join(PROJECT_DIR, "platformio.ini"))
+    return [section[4:] for section in config.sections() if section.startswith("env:")]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Check the firmware footprint against budgets.")
+    parser.add_argument("-u", "--update", action="store_true",
+                        help="record the current sizes as budgets")
+    parser.add_argument("-v", "--verbose", action="store_true",
+                        help="print the sizes per object")
+    parser.add_argument("-b", "--budget", default=DEFAULT_BUDGET, help="budget file")
+    parser.add_argument("environments", nargs="*")
+    args = parser.parse_args()
+
+    objdump = findObjdump()
+    budget = readBudget(args.budget)
+    envs = args.environments or environments()
+    ok = True
+
+    for env in envs:
+        total, objects, symbols = measure(objdump, env)
+        writeReport(env, total, objects, symbols)
+
+        if args.verbose:
+            for obj, size in sorted(objects.items(), key=lambda item: -item[1].flash):
+                print("%-20s %-50s %6d %5d" % (env, obj, size.flash, size.ram))
+
+        device = budget.get((env, DEVICE))
+        if device:
+            ok = check(env, DEVICE, total, device) and ok
+        else:
+            print("%-20s no device limits in %s" % (env, args.budget))
+
+        if args.update:
+            for key in [key for key in budget if key[0] == env and key[1] != DEVICE]:
+                del budget[key]
+            budget[(env, TOTAL)] = total
+            for obj in sorted(objects):
+                budget[(env, obj)] = objects[obj]
+            continue
+
+        recorded = [(item, limit) for (item_env, item), limit in budget.items()
+                    if item_env == env and item != DEVICE]
+        if (env, TOTAL) not in budget:
+            # any growth goes unnoticed until the sizes are recorded
+            print("%-20s warning: no recorded sizes in %s, run \"make footprint-update\""
+                  % (env, args.budget))
+        for item, limit in recorded:
+            size = total if item == TOTAL else objects.get(item, Size())
+            ok = check(env, item, size, limit) and ok
+        if recorded:
+            for obj in sorted(set(objects) - set(item for item, _ in recorded)):
+                print("%-20s %-50s new, not in %s" % (env, obj, args.budget))
+
+    if args.update:
+        # keep the environments together, in the order of the file
+        order = {}
+        for env, _ in budget:
+            order.setdefault(env, len(order))
+        writeBudget(args.budget, dict(sorted(budget.items(),
+                                             key=lambda item: (order[item[0][0]],
+                                                               item[0][1] != DEVICE,
+                                                               item[0][1] != TOTAL,
+                                                               item[0][1]))))
+
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,34 @@
+/*  Host stand-in for <LUFA/Drivers/USB/USB.h>
+
+    Only the HID report descriptor of descriptors.c is built for the host
+    (see the mouse_report.c rule in tools/Makefile). It takes the report
+    item macros from the real LUFA header. The other descriptor types in
+    descriptors.h are opaque, as the host tools do not use them. The report
+    structs of reports.h only need ATTR_PACKED.
+*/
+
+#pragma once
+#ifndef HOST_LUFA_USB_H
+#define HOST_LUFA_USB_H
+
+#include <stdint.h>
+
+// from LUFA/Common/Common.h
+#define CONCAT(x, y) x ## y
+#define CONCAT_EXPANDED(x, y) CONCAT(x, y)
+
+#include <LUFA/Drivers/USB/Class/Common/HIDReportData.h>
+
+
+typedef uint8_t USB_Descriptor_HIDReport_Datatype_t;
+
+typedef struct { uint8_t Data[9]; } USB_Descriptor_Configuration_Header_t;
+typedef struct { uint8_t Data[9]; } USB_Descriptor_Interface_t;
+typedef struct { uint8_t Data[9]; } USB_HID_Descriptor_HID_t;
+typedef struct { uint8_t Data[7]; } USB_Descriptor_Endpoint_t;
+
+#define ATTR_WARN_UNUSED_RESULT
+#define ATTR_PACKED __attribute__ ((packed))
+#define ATTR_NON_NULL_PTR_ARG(...)
+
+#endif
@@ -0,0 +1,22 @@
+/*  Host stand-in for <avr/interrupt.h>. Interrupt handlers are plain
+    functions, which the host code can call to simulate the interrupt.
+*/
+
+#pragma once
+#ifndef HOST_AVR_INTERRUPT_H
+#define HOST_AVR_INTERRUPT_H
+
+#include <avr/io.h>
+
+#ifdef __cplusplus
+#define ISR(vector, ...) extern "C" void vector(void); extern "C" void vector(void)
+#else
+#define ISR(vector, ...) void vector(void); void vector(void)
+#endif
+#define ISR_ALIASOF(vector)
+#define ISR_NOBLOCK
+
+#define sei()
+#define cli()
+
+#endif
@@ -0,0 +1,60 @@
+/*  Host stand-in for <avr/io.h>
+
+    The ATmega32u4 registers used by the C1351 processing code are plain
+    variables (avr_registers.cpp), so that the firmware sources compile on
+    the host unmodified. Writing a register has no side effect. Bit numbers
+    are those of the ATmega32u4.
+*/
+
+#pragma once
+#ifndef HOST_AVR_IO_H
+#define HOST_AVR_IO_H
+
+#include <stdint.h>
+
+#define _BV(bit) (1 << (bit))
+
+
+#define HOST_REGISTER(name) extern volatile uint8_t name;
+
+#define HOST_REGISTERS(X) \
+    X(PINB) X(DDRB) X(PORTB) \
+    X(PINC) X(DDRC) X(PORTC) \
+    X(PIND) X(DDRD) X(PORTD) \
+    X(PINE) X(DDRE) X(PORTE) \
+    X(PINF) X(DDRF) X(PORTF) \
+    X(EICRA) X(EICRB) X(EIMSK) X(EIFR) \
+    X(PCICR) X(PCIFR) X(PCMSK0) \
+    X(SREG)
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+HOST_REGISTERS(HOST_REGISTER)
+#ifdef __cplusplus
+}
+#endif
+
+// iopin.hpp declares a port for each PORTx macro
+#define PORTB PORTB
+#define PORTC PORTC
+#define PORTD PORTD
+#define PORTE PORTE
+#define PORTF PORTF
+
+// EICRA
+#define ISC10 2
+#define ISC11 3
+// EIMSK, EIFR
+#define INT1 1
+#define INTF1 1
+// PCICR, PCIFR, PCMSK0
+#define PCIE0 0
+#define PCIF0 0
+#define PCINT1 1
+#define PCINT4 4
+// SREG
+#define SREG_I 7
+
+#endif
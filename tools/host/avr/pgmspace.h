@@ -0,0 +1,15 @@
+/*  Host stand-in for <avr/pgmspace.h>. Program memory is ordinary memory. */
+
+#pragma once
+#ifndef HOST_AVR_PGMSPACE_H
+#define HOST_AVR_PGMSPACE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define pgm_read_byte(address) (*(const uint8_t*)(address))
+#define pgm_read_word(address) (*(const uint16_t*)(address))
+#define memcpy_P memcpy
+
+#endif
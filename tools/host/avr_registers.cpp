@@ -0,0 +1,8 @@
+#include <avr/io.h>
+
+
+#define HOST_REGISTER_DEFINITION(name) volatile uint8_t name;
+
+extern "C" {
+HOST_REGISTERS(HOST_REGISTER_DEFINITION)
+}
@@ -0,0 +1,137 @@
+#include <avr/io.h>
+
+#include "board.hpp"
+#include "capture_timer.hpp"
+#include "pipeline.hpp"
+
+
+namespace c1351_mouse {
+
+/*  Capture timer API on the host
+
+    Timestamps are set by HostPipeline::runCycle() instead of in a capture
+    interrupt. A channel runs from armInputCapture() until its edge is
+    delivered or it is disarmed, like a hardware capture timer.
+*/
+
+static uint16_t timestamps[2];
+static bool running[2];
+
+
+void initInputCapture()
+{
+    for (uint8_t n = TIMER_1; n <= TIMER_3; n++) {
+        timestamps[n] = 0;
+        running[n] = false;
+    }
+}
+
+
+void armInputCapture()
+{
+    running[TIMER_1] = true;
+    running[TIMER_3] = true;
+}
+
+
+void disarmInputCapture(TimerNumber n)
+{
+    running[n] = false;
+}
+
+
+bool timerRunning(TimerNumber n)
+{
+    return running[n];
+}
+
+
+bool captureDelayed(TimerNumber)
+{
+    return false;
+}
+
+
+uint16_t getInputCaptureTimestamp(TimerNumber n)
+{
+    return timestamps[n];
+}
+
+
+/* The edge of a channel, as the capture unit would see it */
+static void captureEdge(TimerNumber n, uint16_t timestamp)
+{
+    if (running[n]) {
+        timestamps[n] = timestamp;
+        running[n] = false;
+    }
+}
+
+
+/* PIN register of a port, where the mouse drives the button lines */
+template<typename Port> volatile uint8_t& pinRegister();
+template<> volatile uint8_t& pinRegister<PortB>() { return PINB; }
+template<> volatile uint8_t& pinRegister<PortC>() { return PINC; }
+template<> volatile uint8_t& pinRegister<PortD>() { return PIND; }
+template<> volatile uint8_t& pinRegister<PortE>() { return PINE; }
+template<> volatile uint8_t& pinRegister<PortF>() { return PINF; }
+
+
+/* Drive an active low button line */
+template<typename P>
+static void setButton(bool pressed)
+{
+    volatile uint8_t& pin = pinRegister<typename P::Port>();
+
+    if (pressed) {
+        pin &= ~_BV(P::BIT);
+    }
+    else {
+        pin |= _BV(P::BIT);
+    }
+}
+
+
+HostPipeline::HostPipeline() : cyclesUntilReport(adapter_settings.ReportInterval)
+{
+    setButton<Board::Btn1>(false);
+    setButton<Board::UpBtn2>(false);
+
+    c1351.init();
+    c1351.setModeSync();
+}
+
+
+bool HostPipeline::runCycle(const CaptureCycle& cycle, MouseSample& sample)
+{
+    if (!cycle.unknown) {
+        lastKnown = cycle;
+    }
+
+    c1351.setModeRead();
+
+    setButton<Board::Btn1>(lastKnown.left);
+    setButton<Board::UpBtn2>(lastKnown.right);
+    if (lastKnown.xCaptured) {
+        captureEdge(Board::POTX_TIMER, lastKnown.potX);
+    }
+    if (lastKnown.yCaptured) {
+        captureEdge(Board::POTY_TIMER, lastKnown.potY);
+    }
+
+    c1351.setModeSync();
+
+    if (--cyclesUntilReport) {
+        return false;
+    }
+    cyclesUntilReport = adapter_settings.ReportInterval;
+
+    c1351.update();
+    sample.x = c1351.getVelocityX();
+    sample.y = c1351.getVelocityY();
+    sample.left = c1351.getLeftButtonValue();
+    sample.right = c1351.getRightButtonValue();
+    return true;
+}
+
+}
@@ -0,0 +1,79 @@
+/*  Host build of the C1351 processing code
+
+    Runs the unmodified C1351Interface (src/controller.cpp) on the host, so
+    that recorded or generated captures can be replayed through the same
+    arithmetic as on the adapter. Registers are plain variables (see
+    avr/io.h in this directory), and the capture timer API
+    (capture_timer.hpp) is implemented by pipeline.cpp: instead of timers 1
+    and 3, each read cycle is described by a CaptureCycle with the
+    timestamps the capture timer would have taken.
+
+    The pipeline uses the global adapter_settings, like the firmware. Set
+    them with resetSettings() or applySettings() before creating it.
+*/
+
+#pragma once
+#ifndef HOST_PIPELINE_HPP
+#define HOST_PIPELINE_HPP
+
+#include <stdint.h>
+
+#include "controller.hpp"
+#include "settings.h"
+
+
+namespace c1351_mouse {
+
+/* One C1351 read cycle, as seen through the capture timer API */
+struct CaptureCycle {
+    // capture timer ticks from setModeSync() to the POTX and POTY edges,
+    // as returned by getInputCaptureTimestamp()
+    uint16_t potX;
+    uint16_t potY;
+    // false if the edge did not come within the read cycle, so that the
+    // timer is still running at the next setModeSync()
+    bool xCaptured;
+    bool yCaptured;
+    // buttons held during the cycle
+    bool left;
+    bool right;
+    // the cycle was not recorded (see loadTrace()), and repeats the
+    // captures and buttons of the last known cycle: the mouse seems to
+    // stand still, and its movement is seen after the gap
+    bool unknown = false;
+};
+
+
+/* Mouse state after C1351Interface::update() */
+struct MouseSample {
+    MouseVelocity x;
+    MouseVelocity y;
+    bool left;
+    bool right;
+};
+
+
+class HostPipeline {
+
+public:
+    /* Start the C1351Interface, like the firmware does at startup */
+    HostPipeline();
+
+    /* Run one read cycle: setModeRead(), the captures, and the
+     * setModeSync() that ends the cycle. Every ReportInterval cycles,
+     * update() is called as well, and the result is stored in sample.
+     * An unknown cycle repeats the last known one. Returns true if sample
+     * was updated.
+     */
+    bool runCycle(const CaptureCycle& cycle, MouseSample& sample);
+
+protected:
+    C1351Interface c1351;
+    uint8_t cyclesUntilReport;
+    // last cycle that was not unknown
+    CaptureCycle lastKnown = {};
+
+};
+
+}
+#endif
@@ -0,0 +1,13 @@
+/*  Host stand-in for <util/atomic.h>. The host build is single threaded
+    and has no interrupts, so atomic blocks run their body once.
+*/
+
+#pragma once
+#ifndef HOST_UTIL_ATOMIC_H
+#define HOST_UTIL_ATOMIC_H
+
+#define ATOMIC_BLOCK(type) for (int atomic_once = 1; atomic_once; atomic_once = 0)
+#define ATOMIC_RESTORESTATE
+#define ATOMIC_FORCEON
+
+#endif
@@ -0,0 +1,179 @@
+#include <cmath>
+#include <cstring>
+
+#include "motion.hpp"
+
+
+using namespace c1351_mouse;
+
+
+namespace {
+
+const uint16_t TICKS_PER_US = F_CPU / 1000000;
+// sync phase of the read cycle, see POT_SYNC_US in controller.cpp
+const uint16_t SYNC_US = 256;
+// the C1351 answers with position 0 this long after the sync phase
+const uint16_t EDGE_BASE_US = 64;
+// positions wrap at 64 steps
+const int32_t POSITION_STEPS = 64;
+// noise spikes move a capture by this many ticks or more either way
+const uint16_t SPIKE_MIN_TICKS = 256;
+const uint16_t SPIKE_RANGE_TICKS = 768;
+
+}
+
+
+const Workload WORKLOADS[] = {
+    {"rest", "mouse still, position dithering between two steps",
+     MOTION_REST, 0, 0, 4, 0, 0, 20000},
+    {"sweep-slow", "constant slow movement, 1 step per 8 cycles",
+     MOTION_SWEEP, 0.125, 0, 4, 0, 0, 20000},
+    {"sweep-fast", "constant fast movement, 12 steps per cycle",
+     MOTION_SWEEP, 12, 0, 4, 0, 0, 20000},
+    {"circle", "circles of 200 steps radius, 1 s each",
+     MOTION_CIRCLE, 200, 1953, 4, 0, 0, 20000},
+    {"flick", "strokes peaking at 30 steps per cycle, near the wrap limit",
+     MOTION_FLICK, 30, 400, 4, 0, 0, 20000},
+    {"micro", "ellipse of 1.5 steps radius",
+     MOTION_MICRO, 1.5, 500, 4, 0, 0, 20000},
+    {"noisy-sweep", "sweep-slow with a noise spike in 1% of the captures",
+     MOTION_SWEEP, 0.125, 0, 4, 0.01, 0, 20000},
+    {"lossy-circle", "circle with a missed edge in 2% of the captures",
+     MOTION_CIRCLE, 200, 1953, 4, 0, 0.02, 20000},
+};
+
+const size_t WORKLOAD_COUNT = sizeof(WORKLOADS) / sizeof(WORKLOADS[0]);
+
+
+const Workload* findWorkload(const char* name)
+{
+    for (const auto& workload : WORKLOADS) {
+        if (!strcmp(workload.name, name)) {
+            return &workload;
+        }
+    }
+    return nullptr;
+}
+
+
+uint64_t workloadSeed(uint64_t seed, const Workload& workload)
+{
+    return seed * WORKLOAD_COUNT + (&workload - WORKLOADS);
+}
+
+
+MotionGenerator::MotionGenerator(const Workload& workload, uint64_t seed) :
+    workload(workload), randomState(seed), startX(0), startY(0), stepX(0), stepY(0)
+{
+}
+
+
+/* SplitMix64, so that workloads are the same on every host */
+uint64_t MotionGenerator::random()
+{
+    uint64_t z = (randomState += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+
+double MotionGenerator::uniform()
+{
+    return (random() >> 11) * 0x1.0p-53;
+}
+
+
+void MotionGenerator::moveTo(double x, double y)
+{
+    stepX = (int32_t)std::floor(x);
+    stepY = (int32_t)std::floor(y);
+    if (cycle == 0) {
+        startX = stepX;
+        startY = stepY;
+    }
+}
+
+
+/* Capture time of the edge at a position, with jitter */
+uint16_t MotionGenerator::edgeTicks(int32_t step)
+{
+    int32_t position = step & (POSITION_STEPS - 1);
+    int32_t jitter = workload.jitterTicks ?
+                     (int32_t)(random() % (2 * workload.jitterTicks + 1)) - workload.jitterTicks : 0;
+
+    return (SYNC_US + EDGE_BASE_US + position * STEP_US) * TICKS_PER_US + jitter;
+}
+
+
+void MotionGenerator::perturb(uint16_t& timestamp, bool& captured)
+{
+    if (workload.spikeRate > 0 && uniform() < workload.spikeRate) {
+        uint16_t offset = SPIKE_MIN_TICKS + random() % SPIKE_RANGE_TICKS;
+        timestamp += random() & 1 ? offset : -offset;
+    }
+    if (workload.missRate > 0 && uniform() < workload.missRate) {
+        captured = false;
+    }
+}
+
+
+CaptureCycle MotionGenerator::next()
+{
+    const double a = workload.amplitude;
+    const double t = cycle;
+    const double angle = workload.period ? 2 * M_PI * t / workload.period : 0;
+
+    switch (workload.pattern) {
+    case MOTION_REST:
+        moveTo(0.5 + 0.7 * (uniform() - 0.5), 0.5 + 0.7 * (uniform() - 0.5));
+        break;
+
+    case MOTION_SWEEP:
+        moveTo(a * t, a * t / 2);
+        break;
+
+    case MOTION_CIRCLE:
+    case MOTION_MICRO:
+        moveTo(a * std::cos(angle), a * std::sin(angle));
+        break;
+
+    case MOTION_FLICK: {
+        // velocity a * sin^2 over a stroke of a quarter period, so a
+        // stroke covers a * length / 2 steps
+        const double length = workload.period / 4.0;
+        const uint32_t stroke = cycle / workload.period;
+        const double k = std::fmin(cycle % workload.period, length);
+        double distance = a * (k / 2 - length / (4 * M_PI) * std::sin(2 * M_PI * k / length));
+
+        if (stroke & 1) {
+            distance = a * length / 2 - distance;
+        }
+        moveTo(distance, 0);
+        break;
+    }
+    }
+
+    CaptureCycle capture = {};
+    capture.potX = edgeTicks(stepX);
+    capture.potY = edgeTicks(stepY);
+    capture.xCaptured = true;
+    capture.yCaptured = true;
+    perturb(capture.potX, capture.xCaptured);
+    perturb(capture.potY, capture.yCaptured);
+
+    cycle++;
+    return capture;
+}
+
+
+int32_t MotionGenerator::getStepsX() const
+{
+    return stepX - startX;
+}
+
+
+int32_t MotionGenerator::getStepsY() const
+{
+    return stepY - startY;
+}
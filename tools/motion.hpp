@@ -0,0 +1,98 @@
+/*  Synthetic C1351 motion
+
+    Generates the captures of a C1351 moved along a pattern, read cycle by
+    read cycle, in the form of the capture timer API (CaptureCycle, see
+    host/pipeline.hpp). The mouse position is tracked in C1351 steps, and
+    each read cycle captures the position modulo 64 steps as the C1351
+    does: the POT line rises STEP_US per step after a fixed delay following
+    the sync.
+
+    A workload is a motion pattern with its parameters, timing jitter, and
+    rates of noise spikes (a capture far off the position for one cycle)
+    and missed edges. The WORKLOADS are the benchmark suite; with the same
+    seed, a workload always produces the same captures.
+*/
+
+#pragma once
+#ifndef MOTION_HPP
+#define MOTION_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "pipeline.hpp"
+
+
+enum MotionPattern {
+    MOTION_REST,    // still, the position dithers between two steps
+    MOTION_SWEEP,   // constant velocity, Amplitude steps per cycle
+    MOTION_CIRCLE,  // circle of radius Amplitude steps
+    MOTION_FLICK,   // fast strokes peaking at Amplitude steps per cycle,
+                    // left and right in turn, with a rest after each
+    MOTION_MICRO,   // small ellipse of radius Amplitude steps
+};
+
+struct Workload {
+    const char* name;
+    const char* description;
+    MotionPattern pattern;
+    double amplitude;
+    // cycles per circle or per flick and rest
+    uint32_t period;
+    // capture timing jitter, up to this many timer ticks either way
+    uint16_t jitterTicks;
+    // probability per cycle and axis of a noise spike or a missed edge
+    double spikeRate;
+    double missRate;
+    // default length of the workload
+    uint32_t cycles;
+};
+
+extern const Workload WORKLOADS[];
+extern const size_t WORKLOAD_COUNT;
+
+/* Workload with the given name, nullptr if there is none */
+const Workload* findWorkload(const char* name);
+/* Seed of the generator of a workload, so that each workload of the suite
+ * has its own sequence for a seed
+ */
+uint64_t workloadSeed(uint64_t seed, const Workload& workload);
+
+
+class MotionGenerator {
+
+public:
+    MotionGenerator(const Workload& workload, uint64_t seed);
+
+    /* Captures of the next read cycle */
+    c1351_mouse::CaptureCycle next();
+
+    /* Movement so far in C1351 steps, as the mouse made it. Each step is
+     * STEP_US of capture time.
+     */
+    int32_t getStepsX() const;
+    int32_t getStepsY() const;
+
+protected:
+    const Workload& workload;
+    uint64_t randomState;
+    uint32_t cycle = 0;
+    int32_t startX;
+    int32_t startY;
+    int32_t stepX;
+    int32_t stepY;
+
+    uint64_t random();
+    // uniform in [0, 1)
+    double uniform();
+    void moveTo(double x, double y);
+    uint16_t edgeTicks(int32_t step);
+    void perturb(uint16_t& timestamp, bool& captured);
+
+};
+
+
+/* Length of one C1351 step in microseconds */
+const uint16_t STEP_US = 2;
+
+#endif
@@ -0,0 +1,133 @@
+/*  Names of the AdapterSettings fields, shared by the host tools
+
+    Settings are named and assigned on the command line as "name=value",
+    see the c1351ctl usage and README.rst.
+*/
+
+#pragma once
+#ifndef SETTINGS_FIELDS_HPP
+#define SETTINGS_FIELDS_HPP
+
+#include <climits>
+#include <cstddef>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "settings.h"
+
+
+enum FieldType {
+    U8,
+    U16,
+    S16
+};
+
+struct Field {
+    const char* name;
+    size_t offset;
+    FieldType type;
+    const char* help;
+};
+
+const Field FIELDS[] = {
+    {"scale", offsetof(AdapterSettings, ScaleDivisor), U8, "timer ticks per mouse count"},
+    {"filter", offsetof(AdapterSettings, FilterShift), U8, "smoothing strength, 0 (off) to 7"},
+    {"spike", offsetof(AdapterSettings, SpikeLimit), U8, "glitch limit in uS per sample, 0 = off"},
+    {"interval", offsetof(AdapterSettings, ReportInterval), U8, "C1351 read cycles per USB report"},
+    {"left", offsetof(AdapterSettings, ButtonMap) + BUTTON_INDEX_LEFT, U8, "HID button mask of left button"},
+    {"right", offsetof(AdapterSettings, ButtonMap) + BUTTON_INDEX_RIGHT, U8, "HID button mask of right button"},
+    {"middle", offsetof(AdapterSettings, ButtonMap) + BUTTON_INDEX_MIDDLE, U8, "HID button mask of left + right chord"},
+    {"xoffset", offsetof(AdapterSettings, PotOffsetX), S16, "paddle and tablet POTX offset in timer ticks"},
+    {"yoffset", offsetof(AdapterSettings, PotOffsetY), S16, "paddle and tablet POTY offset in timer ticks"},
+    {"accel", offsetof(AdapterSettings, AccelProfile), U8, "acceleration: 0 flat, 1 linear, 2 sigmoid"},
+    {"input", offsetof(AdapterSettings, InputMode), U8, "mouse type: 0 auto, 1 C1351, 2 Amiga, 3 Atari ST, 4 joystick, 5 paddles, 6 tablet"},
+    {"joyout", offsetof(AdapterSettings, JoystickOutput), U8, "joystick report: 0 gamepad, 1 mouse"},
+    {"joyramp", offsetof(AdapterSettings, JoystickRamp), U8, "joystick mouse speed increase per report, in 1/16 counts"},
+    {"joymax", offsetof(AdapterSettings, JoystickMaxSpeed), U8, "joystick mouse top speed in counts per report"},
+    {"paddlerange", offsetof(AdapterSettings, PaddleRange), U16, "paddle charge time in uS for full scale, 1 to 500"},
+    {"paddleavg", offsetof(AdapterSettings, PaddleAverageShift), U8, "average 2^n paddle readings per report, 0 to 4"},
+    {"scrollbtn", offsetof(AdapterSettings, ScrollButtons), U8, "buttons held to scroll: 0 off, 1 left, 2 right, 3 both, 4 middle"},
+    {"chord", offsetof(AdapterSettings, ChordWindow), U8, "ms between left and right for a middle click, 0 off"},
+    {"gesture", offsetof(AdapterSettings, GestureButtons), U8, "buttons held to flick: 0 off, 1 left, 2 right, 3 both, 4 middle"},
+    {"keymiddle", offsetof(AdapterSettings, KeyBindings[KEY_BINDING_MIDDLE].KeyCode), U8, "HID key code sent by the middle button, 0 off"},
+    {"modmiddle", offsetof(AdapterSettings, KeyBindings[KEY_BINDING_MIDDLE].Modifier), U8, "HID modifiers sent with keymiddle"},
+    {"keyleft", offsetof(AdapterSettings, KeyBindings[KEY_BINDING_FLICK_LEFT].KeyCode), U8, "HID key code sent by a left flick, 0 off"},
+    {"modleft", offsetof(AdapterSettings, KeyBindings[KEY_BINDING_FLICK_LEFT].Modifier), U8, "HID modifiers sent with keyleft"},
+    {"keyright", offsetof(AdapterSettings, KeyBindings[KEY_BINDING_FLICK_RIGHT].KeyCode), U8, "HID key code sent by a right flick, 0 off"},
+    {"modright", offsetof(AdapterSettings, KeyBindings[KEY_BINDING_FLICK_RIGHT].Modifier), U8, "HID modifiers sent with keyright"},
+    {"keyup", offsetof(AdapterSettings, KeyBindings[KEY_BINDING_FLICK_UP].KeyCode), U8, "HID key code sent by an up flick, 0 off"},
+    {"modup", offsetof(AdapterSettings, KeyBindings[KEY_BINDING_FLICK_UP].Modifier), U8, "HID modifiers sent with keyup"},
+    {"keydown", offsetof(AdapterSettings, KeyBindings[KEY_BINDING_FLICK_DOWN].KeyCode), U8, "HID key code sent by a down flick, 0 off"},
+    {"moddown", offsetof(AdapterSettings, KeyBindings[KEY_BINDING_FLICK_DOWN].Modifier), U8, "HID modifiers sent with keydown"},
+    {"scrolldiv", offsetof(AdapterSettings, ScrollDivisor), U8, "mouse counts per wheel detent"},
+    {"readmargin", offsetof(AdapterSettings, ReadPhaseMargin), U8, "uS after the latest C1351 edge that ends a read, 0 = full 256 uS"},
+};
+
+
+inline long getField(const AdapterSettings& settings, const Field& field)
+{
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&settings) + field.offset;
+    if (field.type == S16) {
+        return (int16_t)(bytes[0] | (bytes[1] << 8));
+    }
+    if (field.type == U16) {
+        return (uint16_t)(bytes[0] | (bytes[1] << 8));
+    }
+    return bytes[0];
+}
+
+
+inline bool setField(AdapterSettings& settings, const Field& field, long value)
+{
+    uint8_t* bytes = reinterpret_cast<uint8_t*>(&settings) + field.offset;
+    if (field.type == S16 || field.type == U16) {
+        if (field.type == S16 ? value < INT16_MIN || value > INT16_MAX :
+                value < 0 || value > 0xffff) {
+            return false;
+        }
+        bytes[0] = value & 0xff;
+        bytes[1] = (value >> 8) & 0xff;
+        return true;
+    }
+    if (value < 0 || value > 0xff) {
+        return false;
+    }
+    bytes[0] = (uint8_t)value;
+    return true;
+}
+
+
+/* Apply a "name=value" assignment. Returns false on a malformed argument. */
+inline bool assign(AdapterSettings& settings, const char* arg)
+{
+    const char* eq = strchr(arg, '=');
+    if (!eq) {
+        return false;
+    }
+
+    std::string name(arg, eq - arg);
+    char* end;
+    long value = strtol(eq + 1, &end, 0);
+    if (*end || end == eq + 1) {
+        fprintf(stderr, "invalid value in '%s'\n", arg);
+        return false;
+    }
+
+    for (const auto& field : FIELDS) {
+        if (name == field.name) {
+            if (!setField(settings, field, value)) {
+                fprintf(stderr, "value out of range in '%s'\n", arg);
+                return false;
+            }
+            return true;
+        }
+    }
+
+    fprintf(stderr, "unknown setting '%s'\n", name.c_str());
+    return false;
+}
+
+#endif
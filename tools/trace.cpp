@@ -0,0 +1,143 @@
+#include <cstring>
+
+#include "trace.hpp"
+
+
+namespace {
+
+const uint8_t CPU_TICKS_PER_US = F_CPU / 1000000;
+
+
+uint16_t readU16(const uint8_t* bytes)
+{
+    return bytes[0] | (bytes[1] << 8);
+}
+
+
+void writeU16(uint8_t* bytes, uint16_t value)
+{
+    bytes[0] = value & 0xff;
+    bytes[1] = value >> 8;
+}
+
+}
+
+
+bool readTraceHeader(FILE* file, TraceHeader& header)
+{
+    uint8_t buf[TRACE_HEADER_SIZE];
+
+    if (fread(buf, sizeof(buf), 1, file) != 1 || memcmp(buf, CAPTURE_TRACE_MAGIC, 4) != 0) {
+        fprintf(stderr, "not a C1351 trace\n");
+        return false;
+    }
+    if (buf[4] != TRACE_VERSION) {
+        fprintf(stderr, "unsupported trace version %u (expected %u)\n", buf[4],
+                TRACE_VERSION);
+        return false;
+    }
+
+    header.ticksPerUs = buf[5];
+    header.cycleUs = readU16(buf + 6);
+    memcpy(&header.settings, buf + 8, sizeof(header.settings));
+    return true;
+}
+
+
+bool readTraceRecord(FILE* file, TraceRecord& record)
+{
+    uint8_t buf[TRACE_RECORD_SIZE];
+
+    if (fread(buf, sizeof(buf), 1, file) != 1) {
+        return false;
+    }
+
+    record.potX = readU16(buf);
+    record.potY = readU16(buf + 2);
+    record.flags = buf[4];
+    record.skipped = buf[5];
+    return true;
+}
+
+
+bool writeTraceHeader(FILE* file, const TraceHeader& header)
+{
+    uint8_t buf[TRACE_HEADER_SIZE] = {};
+
+    memcpy(buf, CAPTURE_TRACE_MAGIC, 4);
+    buf[4] = TRACE_VERSION;
+    buf[5] = header.ticksPerUs;
+    writeU16(buf + 6, header.cycleUs);
+    memcpy(buf + 8, &header.settings, sizeof(header.settings));
+    return fwrite(buf, sizeof(buf), 1, file) == 1;
+}
+
+
+bool writeTraceRecord(FILE* file, const TraceRecord& record)
+{
+    uint8_t buf[TRACE_RECORD_SIZE];
+
+    writeU16(buf, record.potX);
+    writeU16(buf + 2, record.potY);
+    buf[4] = record.flags;
+    buf[5] = record.skipped;
+    return fwrite(buf, sizeof(buf), 1, file) == 1;
+}
+
+
+c1351_mouse::CaptureCycle toCaptureCycle(const TraceRecord& record)
+{
+    c1351_mouse::CaptureCycle cycle;
+
+    cycle.potX = record.potX;
+    cycle.potY = record.potY;
+    cycle.xCaptured = record.flags & TRACE_FLAG_X_CAPTURED;
+    cycle.yCaptured = record.flags & TRACE_FLAG_Y_CAPTURED;
+    cycle.left = record.flags & TRACE_FLAG_LEFT;
+    cycle.right = record.flags & TRACE_FLAG_RIGHT;
+    return cycle;
+}
+
+
+TraceRecord toTraceRecord(const c1351_mouse::CaptureCycle& cycle)
+{
+    TraceRecord record;
+
+    record.potX = cycle.potX;
+    record.potY = cycle.potY;
+    record.flags = (cycle.xCaptured ? TRACE_FLAG_X_CAPTURED : 0) |
+                   (cycle.yCaptured ? TRACE_FLAG_Y_CAPTURED : 0) |
+                   (cycle.left ? TRACE_FLAG_LEFT : 0) |
+                   (cycle.right ? TRACE_FLAG_RIGHT : 0);
+    record.skipped = 0;
+    return record;
+}
+
+
+bool loadTrace(const char* path, TraceHeader& header,
+               std::vector<c1351_mouse::CaptureCycle>& cycles)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        perror(path);
+        return false;
+    }
+
+    bool ok = readTraceHeader(file, header);
+    TraceRecord record;
+    while (ok && readTraceRecord(file, record)) {
+        c1351_mouse::CaptureCycle unknown = {};
+
+        unknown.unknown = true;
+        cycles.insert(cycles.end(), record.skipped, unknown);
+        cycles.push_back(toCaptureCycle(record));
+    }
+    fclose(file);
+
+    if (ok && header.ticksPerUs != CPU_TICKS_PER_US) {
+        fprintf(stderr, "trace has %u timer ticks per uS, the host build %u\n",
+                header.ticksPerUs, CPU_TICKS_PER_US);
+        ok = false;
+    }
+    return ok;
+}
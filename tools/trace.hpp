@@ -0,0 +1,64 @@
+/*  Reading and writing C1351 capture trace files
+
+    The format is described in capture_trace.h, which the firmware uses to
+    send traces.
+*/
+
+#pragma once
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "capture_trace.h"
+#include "pipeline.hpp"
+#include "settings.h"
+
+
+const uint8_t TRACE_VERSION = CAPTURE_TRACE_VERSION;
+const size_t TRACE_HEADER_SIZE = CAPTURE_TRACE_HEADER_SIZE;
+const size_t TRACE_RECORD_SIZE = CAPTURE_TRACE_RECORD_SIZE;
+// read cycle of the firmware with the default settings
+const uint16_t TRACE_DEFAULT_CYCLE_US = 512;
+
+struct TraceHeader {
+    uint8_t ticksPerUs;
+    uint16_t cycleUs;
+    AdapterSettings settings;
+};
+
+struct TraceRecord {
+    uint16_t potX;
+    uint16_t potY;
+    uint8_t flags;
+    uint8_t skipped;
+};
+
+
+/* Read the header of a trace file. Returns false and prints the reason if
+ * it is not a supported trace.
+ */
+bool readTraceHeader(FILE* file, TraceHeader& header);
+/* Read the next record. Returns false at the end of the file. */
+bool readTraceRecord(FILE* file, TraceRecord& record);
+
+bool writeTraceHeader(FILE* file, const TraceHeader& header);
+bool writeTraceRecord(FILE* file, const TraceRecord& record);
+
+/* Read a whole trace file, as the captures of each read cycle. Skipped
+ * cycles are unknown cycles (see CaptureCycle). Returns false and prints the
+ * reason if the file cannot be read or has another capture timer rate
+ * than the host build.
+ */
+bool loadTrace(const char* path, TraceHeader& header,
+               std::vector<c1351_mouse::CaptureCycle>& cycles);
+
+/* Conversion between a record and the captures of its read cycle. Records
+ * are taken with skipped = 0.
+ */
+c1351_mouse::CaptureCycle toCaptureCycle(const TraceRecord& record);
+TraceRecord toTraceRecord(const c1351_mouse::CaptureCycle& cycle);
+
+#endif